@@ -0,0 +1,87 @@
+/*
+  HampelFilter.h - Hampel outlier filter for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   A HampelFilter flags samples that lie more than k scaled MADs from the median of the sliding window that ends with them:
+
+      |sample - median| > k * 1.4826 * MAD
+
+   1.4826 scales the MAD to the standard deviation of normally distributed data, so k = 3 is the usual three sigma rule.
+   Median and MAD come from one MedianFilter window: in() stores the raw sample once, reads the median and selects the MAD
+   from the same sorted order (see MedianFilter::getMAD()).
+
+   HampelMode::Replace (default) returns the window median in place of an outlier and the sample itself otherwise.
+   HampelMode::Flag always returns the sample and only reports it through isOutlier() and the outlier count.
+   Outliers stay in the window in both modes, so a genuine step is followed after half a window.
+
+   The buffer form of in() runs a whole block, optionally writing a 0 / 1 flag per sample, and returns its outlier count.
+ */
+
+#ifndef HampelFilter_h
+
+   #define HampelFilter_h
+
+   #include "MedianFilter.h"
+
+   #ifndef HAMPEL_FILTER_MAD_SCALE
+      #define HAMPEL_FILTER_MAD_SCALE 1.4826   // MAD to standard deviation of a normal distribution
+   #endif
+
+   enum class HampelMode : uint8_t
+   {
+      Replace,    // outliers are replaced with the window median
+      Flag        // samples pass through unchanged, outliers are only counted and flagged
+   };
+
+   template <typename T, typename Sum, typename Index = uint8_t>
+   class HampelFilter
+   {
+      public:
+         HampelFilter(size_t size, T seed, double threshold = 3.0, HampelMode mode = HampelMode::Replace);
+
+         T in(const T & value);
+         size_t in(const T * src, T * dst, size_t n, uint8_t * flags = nullptr);   // dst may equal src, returns the outliers found
+
+         bool isOutlier() const;                 // the last sample given to in()
+         uint32_t getOutlierCount() const;       // outliers since construction or the last reset
+         void resetOutlierCount();
+
+         double getThreshold() const;
+         void setThreshold(double threshold);    // in scaled MADs
+         HampelMode getMode() const;
+         void setMode(HampelMode mode);
+
+         T out() const;                          // current window median
+         Sum getMAD() const;
+         const MedianFilter<T, Sum, Index> & window() const;
+
+         void reset(T seed);
+
+      private:
+         MedianFilter<T, Sum, Index> filter;
+         double limit;            // threshold * HAMPEL_FILTER_MAD_SCALE, compared against MAD directly
+         HampelMode mode;
+         bool lastOutlier;
+         uint32_t outlierCount;
+
+         bool classify(const T & value, T & median) const;
+   };
+
+#include "HampelFilter.hpp"
+
+#endif
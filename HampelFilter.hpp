@@ -0,0 +1,145 @@
+/*
+   HampelFilter.hpp - Hampel outlier filter for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "HampelFilter.h"
+
+template <typename T, typename Sum, typename Index>
+HampelFilter<T, Sum, Index>::HampelFilter(size_t size, T seed, double threshold, HampelMode mode) :
+   filter(size, seed),
+   limit { threshold * HAMPEL_FILTER_MAD_SCALE },
+   mode { mode },
+   lastOutlier { false },
+   outlierCount { 0 }
+{
+}
+
+template <typename T, typename Sum, typename Index>
+bool HampelFilter<T, Sum, Index>::classify(const T & value, T & median) const
+{
+   median = filter.out();
+
+   const double deviation = (double) value - (double) median;
+   const double bound = limit * (double) filter.getMAD();
+
+   return (deviation > bound) || (-deviation > bound);   // false for NaN samples
+}
+
+template <typename T, typename Sum, typename Index>
+T HampelFilter<T, Sum, Index>::in(const T & value)
+{
+   filter.in(value);
+
+   T median;
+   lastOutlier = classify(value, median);
+   if(!lastOutlier) return value;
+
+   outlierCount++;
+   return (mode == HampelMode::Replace) ? median : value;
+}
+
+template <typename T, typename Sum, typename Index>
+size_t HampelFilter<T, Sum, Index>::in(const T * src, T * dst, size_t n, uint8_t * flags)
+{
+   const bool replace = (mode == HampelMode::Replace);
+   size_t found = 0;
+
+   for(size_t i = 0; i < n; i++)
+   {
+      const T value = src[i];   // read before dst[i] is written, dst may equal src
+      filter.in(value);
+
+      T median;
+      const bool outlier = classify(value, median);
+
+      dst[i] = (outlier && replace) ? median : value;
+      if(flags) flags[i] = outlier;
+      found += outlier;
+      lastOutlier = outlier;
+   }
+
+   outlierCount += found;
+   return found;
+}
+
+template <typename T, typename Sum, typename Index>
+bool HampelFilter<T, Sum, Index>::isOutlier() const
+{
+   return lastOutlier;
+}
+
+template <typename T, typename Sum, typename Index>
+uint32_t HampelFilter<T, Sum, Index>::getOutlierCount() const
+{
+   return outlierCount;
+}
+
+template <typename T, typename Sum, typename Index>
+void HampelFilter<T, Sum, Index>::resetOutlierCount()
+{
+   outlierCount = 0;
+}
+
+template <typename T, typename Sum, typename Index>
+double HampelFilter<T, Sum, Index>::getThreshold() const
+{
+   return limit / HAMPEL_FILTER_MAD_SCALE;
+}
+
+template <typename T, typename Sum, typename Index>
+void HampelFilter<T, Sum, Index>::setThreshold(double threshold)
+{
+   limit = threshold * HAMPEL_FILTER_MAD_SCALE;
+}
+
+template <typename T, typename Sum, typename Index>
+HampelMode HampelFilter<T, Sum, Index>::getMode() const
+{
+   return mode;
+}
+
+template <typename T, typename Sum, typename Index>
+void HampelFilter<T, Sum, Index>::setMode(HampelMode mode)
+{
+   this->mode = mode;
+}
+
+template <typename T, typename Sum, typename Index>
+T HampelFilter<T, Sum, Index>::out() const
+{
+   return filter.out();
+}
+
+template <typename T, typename Sum, typename Index>
+Sum HampelFilter<T, Sum, Index>::getMAD() const
+{
+   return filter.getMAD();
+}
+
+template <typename T, typename Sum, typename Index>
+const MedianFilter<T, Sum, Index> & HampelFilter<T, Sum, Index>::window() const
+{
+   return filter;
+}
+
+template <typename T, typename Sum, typename Index>
+void HampelFilter<T, Sum, Index>::reset(T seed)
+{
+   filter.reset(seed);
+   lastOutlier = false;
+   outlierCount = 0;
+}
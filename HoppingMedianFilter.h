@@ -0,0 +1,100 @@
+/*
+  HoppingMedianFilter.h - Hopping and tumbling window median filter for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   A HoppingMedianFilter reports the median of the last `size` samples once every `hop` samples instead of after every one:
+
+      HoppingMedianFilter<int, long> filter(255, 64, 0);   // median of the last 255 samples, every 64 samples
+      if(filter.in(value)) report(filter.out());
+
+   in() only buffers the sample and returns true when it completes a hop, at which point out() and the other queries move
+   to the new window.  Between hops they keep describing the window at the last hop, which starts out filled with seed
+   just like MedianFilter.  For NaN free input every hop reports exactly what MedianFilter::in() would have returned for
+   that sample.
+
+   Overlapping windows (hop < size) keep the window sorted.  At a hop the new block and the samples it pushes out are
+   sorted, and one merge pass over the window drops the old samples and inserts the new ones, O(size + hop log hop) per
+   hop instead of O(size) per sample.  Every query is then O(1).  When hop divides size the ring buffer keeps each block
+   sorted, so the block leaving needs no second sort.  With a hop below about size / 16 a plain MedianFilter is cheaper.
+   Tumbling windows (hop == size) and sampled windows (hop > size, samples older than the window are skipped) copy the
+   window once per hop and select the median with std::nth_element, O(size) per hop.  getMin() and getMax() then scan
+   the window and getRank() and the quantiles select again, O(size) per call.  Selecting reorders the copy of the window,
+   so getRank(), getQuantile() and getQuantiles() are not const; every const method only reads.
+
+   NaN samples sort above every number, where MedianFilter compares them with <, so the two differ once NaN is in the
+   window.  The median of an even window is the upper one of the middle pair.
+ */
+
+#ifndef HoppingMedianFilter_h
+
+   #define HoppingMedianFilter_h
+
+   #include "MedianFilter.h"
+
+   template <typename T, typename Sum>
+   class HoppingMedianFilter
+   {
+      public:
+         HoppingMedianFilter(size_t size, size_t hop, T seed);
+         HoppingMedianFilter(const HoppingMedianFilter<T, Sum> &other);
+         HoppingMedianFilter(HoppingMedianFilter<T, Sum> &&other);
+         ~HoppingMedianFilter();
+
+         bool in(const T & value);                       // buffer value, true when it completed a hop
+         size_t in(const T * src, T * dst, size_t n);    // one median per completed hop into dst, returns how many
+         T out() const;                                  // median at the last hop
+
+         T getMin() const;
+         T getMax() const;
+         Sum getMean() const;
+
+         T getRank(size_t k);                    // k-th smallest sample, 0 is getMin(), size - 1 is getMax()
+         Sum getQuantile(double p);               // p in [0, 1], linear interpolation between ranks
+         void getQuantiles(const double * p, Sum * quantiles, size_t count);
+
+         size_t getHop() const;
+         size_t pending() const;                  // samples taken since the last hop
+
+         void reset(T seed);
+
+         HoppingMedianFilter<T, Sum>& operator=(const HoppingMedianFilter<T, Sum>&);
+         HoppingMedianFilter<T, Sum>& operator=(HoppingMedianFilter<T, Sum>&&);
+
+      private:
+         size_t medFilterWin;      // samples in the window
+         size_t hopSize;           // samples between two medians
+         size_t oldestDataPoint;   // oldest data point location in ring buffer
+         size_t taken;             // samples taken since the last hop
+         T median;                 // median at the last hop
+         T * data;                 // array pointer for the window in ring buffer order
+         T * window;               // the window at the last hop, sorted when merging, partitioned around the median otherwise
+         T * incoming;             // samples of the current hop (merging only)
+         T * outgoing;             // samples the current hop pushes out (merging with hops that do not tile the window)
+         T * spare;                // merge destination, swapped with window (merging only)
+
+         bool merging() const;
+         void allocate();
+         void release();
+         void copyFrom(const HoppingMedianFilter<T, Sum> &other);
+         void merge();
+         void select();
+   };
+
+#include "HoppingMedianFilter.hpp"
+
+#endif
@@ -0,0 +1,321 @@
+/*
+   HoppingMedianFilter.hpp - Hopping and tumbling window median filter for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "HoppingMedianFilter.h"
+
+#include <algorithm>
+
+template <typename T, typename Sum>
+HoppingMedianFilter<T, Sum>::HoppingMedianFilter(size_t size, size_t hop, T seed)
+{
+   medFilterWin = size < 3 ? 3 : size;   // same minimum as MedianFilter
+   hopSize      = hop < 1 ? 1 : hop;
+
+   allocate();
+   reset(seed);
+}
+
+template <typename T, typename Sum>
+HoppingMedianFilter<T, Sum>::HoppingMedianFilter(const HoppingMedianFilter<T, Sum> &other) :
+   medFilterWin { other.medFilterWin },
+   hopSize { other.hopSize } {
+   allocate();
+   copyFrom(other);
+}
+
+template <typename T, typename Sum>
+HoppingMedianFilter<T, Sum>& HoppingMedianFilter<T, Sum>::operator=(const HoppingMedianFilter<T, Sum>& other) {
+   if(this == &other) return *this;
+
+   release();
+   medFilterWin = other.medFilterWin;
+   hopSize = other.hopSize;
+   allocate();
+   copyFrom(other);
+
+   return *this;
+}
+
+template <typename T, typename Sum>
+HoppingMedianFilter<T, Sum>::HoppingMedianFilter(HoppingMedianFilter<T, Sum> &&other) :
+   medFilterWin { other.medFilterWin },
+   hopSize { other.hopSize },
+   oldestDataPoint { other.oldestDataPoint },
+   taken { other.taken },
+   median { other.median },
+   data { other.data },
+   window { other.window },
+   incoming { other.incoming },
+   outgoing { other.outgoing },
+   spare { other.spare } {
+   other.data = nullptr;
+   other.window = nullptr;
+   other.incoming = nullptr;
+   other.outgoing = nullptr;
+   other.spare = nullptr;
+}
+
+template <typename T, typename Sum>
+HoppingMedianFilter<T, Sum>& HoppingMedianFilter<T, Sum>::operator=(HoppingMedianFilter<T, Sum>&& other) {
+   if(this == &other) return *this;
+
+   release();
+   medFilterWin = other.medFilterWin;
+   hopSize = other.hopSize;
+   oldestDataPoint = other.oldestDataPoint;
+   taken = other.taken;
+   median = other.median;
+   data = other.data;
+   window = other.window;
+   incoming = other.incoming;
+   outgoing = other.outgoing;
+   spare = other.spare;
+   other.data = nullptr;
+   other.window = nullptr;
+   other.incoming = nullptr;
+   other.outgoing = nullptr;
+   other.spare = nullptr;
+   return *this;
+}
+
+template <typename T, typename Sum>
+HoppingMedianFilter<T, Sum>::~HoppingMedianFilter()
+{
+   release();
+}
+
+template <typename T, typename Sum>
+bool HoppingMedianFilter<T, Sum>::merging() const
+{
+   return hopSize < medFilterWin;
+}
+
+template <typename T, typename Sum>
+void HoppingMedianFilter<T, Sum>::allocate()
+{
+   data   = (T*) calloc (medFilterWin, sizeof(T));   // array for data
+   window = (T*) calloc (medFilterWin, sizeof(T));   // array for the window at the last hop
+
+   if(merging())
+   {
+      incoming = (T*) calloc (hopSize, sizeof(T));
+      outgoing = (medFilterWin % hopSize != 0) ? (T*) calloc (hopSize, sizeof(T)) : nullptr;   // whole blocks leave sorted
+      spare    = (T*) calloc (medFilterWin, sizeof(T));
+   }
+   else
+   {
+      incoming = nullptr;
+      outgoing = nullptr;
+      spare    = nullptr;
+   }
+}
+
+template <typename T, typename Sum>
+void HoppingMedianFilter<T, Sum>::release()
+{
+   free(data);
+   free(window);
+   free(incoming);
+   free(outgoing);
+   free(spare);
+}
+
+template <typename T, typename Sum>
+void HoppingMedianFilter<T, Sum>::copyFrom(const HoppingMedianFilter<T, Sum> &other)
+{
+   oldestDataPoint = other.oldestDataPoint;
+   taken = other.taken;
+   median = other.median;
+   memcpy(data, other.data, medFilterWin * sizeof(T));
+   memcpy(window, other.window, medFilterWin * sizeof(T));
+   if(merging()) memcpy(incoming, other.incoming, hopSize * sizeof(T));
+}
+
+template <typename T, typename Sum>
+bool HoppingMedianFilter<T, Sum>::in(const T & value)
+{
+   if(merging())
+   {
+      incoming[taken] = value;
+      if(++taken < hopSize) return false;
+      merge();
+   }
+   else
+   {
+      data[oldestDataPoint] = value;   // overwrite the oldest sample, older ones of a long hop simply fall out
+      if(++oldestDataPoint == medFilterWin) oldestDataPoint = 0;
+      if(++taken < hopSize) return false;
+      select();
+   }
+
+   taken = 0;
+   return true;
+}
+
+template <typename T, typename Sum>
+size_t HoppingMedianFilter<T, Sum>::in(const T * src, T * dst, size_t n)
+{
+   size_t medians = 0;
+
+   for(size_t i = 0; i < n; i++)
+   {
+      if(in(src[i])) dst[medians++] = median;
+   }
+   return medians;
+}
+
+template <typename T, typename Sum>
+void HoppingMedianFilter<T, Sum>::merge()
+{
+   auto less = [](const T & a, const T & b) { return median_filter_detail::ordered_less(a, b); };
+
+   // the new block replaces the hop oldest samples in the ring buffer.  When hops tile the window the ring holds whole
+   // blocks, stored sorted, so the block leaving is already in order.  Otherwise the ring keeps arrival order, which
+   // decides what leaves at later hops, and the samples leaving are sorted here
+   const bool tiled = (medFilterWin % hopSize == 0);
+   const T * old = data + oldestDataPoint;
+   if(!tiled)
+   {
+      size_t slot = oldestDataPoint;
+      for(size_t i = 0; i < hopSize; i++)
+      {
+         outgoing[i] = data[slot];
+         data[slot] = incoming[i];
+         if(++slot == medFilterWin) slot = 0;
+      }
+      std::sort(outgoing, outgoing + hopSize, less);
+      old = outgoing;
+   }
+   std::sort(incoming, incoming + hopSize, less);
+
+   // one pass over the sorted window: skip the outgoing samples, merge in the incoming ones
+   size_t o = 0, n = 0, k = 0;
+   for(size_t w = 0; w < medFilterWin; w++)
+   {
+      const T & kept = window[w];
+      if(o < hopSize && !less(kept, old[o]) && !less(old[o], kept))
+      {
+         o++;
+         continue;
+      }
+      while(n < hopSize && less(incoming[n], kept)) spare[k++] = incoming[n++];
+      spare[k++] = kept;
+   }
+   while(n < hopSize) spare[k++] = incoming[n++];
+
+   if(tiled) memcpy(data + oldestDataPoint, incoming, hopSize * sizeof(T));
+   oldestDataPoint = (oldestDataPoint + hopSize) % medFilterWin;
+
+   T * merged = window;
+   window = spare;
+   spare  = merged;
+   median = window[medFilterWin / 2];
+}
+
+template <typename T, typename Sum>
+void HoppingMedianFilter<T, Sum>::select()
+{
+   auto less = [](const T & a, const T & b) { return median_filter_detail::ordered_less(a, b); };
+
+   memcpy(window, data, medFilterWin * sizeof(T));
+   std::nth_element(window, window + medFilterWin / 2, window + medFilterWin, less);
+   median = window[medFilterWin / 2];
+}
+
+template <typename T, typename Sum>
+T HoppingMedianFilter<T, Sum>::out() const
+{
+   return median;
+}
+
+template <typename T, typename Sum>
+T HoppingMedianFilter<T, Sum>::getMin() const
+{
+   if(merging()) return window[0];
+   return *std::min_element(window, window + medFilterWin, [](const T & a, const T & b) { return median_filter_detail::ordered_less(a, b); });
+}
+
+template <typename T, typename Sum>
+T HoppingMedianFilter<T, Sum>::getMax() const
+{
+   if(merging()) return window[medFilterWin - 1];
+   return *std::max_element(window, window + medFilterWin, [](const T & a, const T & b) { return median_filter_detail::ordered_less(a, b); });
+}
+
+template <typename T, typename Sum>
+Sum HoppingMedianFilter<T, Sum>::getMean() const
+{
+   Sum totalSum = 0;
+   for(size_t i = 0; i < medFilterWin; i++) totalSum += (Sum) window[i];
+   return totalSum / (Sum) medFilterWin;
+}
+
+template <typename T, typename Sum>
+T HoppingMedianFilter<T, Sum>::getRank(size_t k)
+{
+   if(k >= medFilterWin) k = medFilterWin - 1;
+   if(merging()) return window[k];
+
+   // reorders the copy of the window only, the median stays in out()
+   std::nth_element(window, window + k, window + medFilterWin, [](const T & a, const T & b) { return median_filter_detail::ordered_less(a, b); });
+   return window[k];
+}
+
+template <typename T, typename Sum>
+Sum HoppingMedianFilter<T, Sum>::getQuantile(double p)
+{
+   const median_filter_detail::QuantilePosition q(p, medFilterWin);
+
+   if(q.fraction == 0.0) return (Sum) getRank(q.rank);
+   return median_filter_detail::interpolate<Sum>(getRank(q.rank), getRank(q.rank + 1), q.fraction);
+}
+
+template <typename T, typename Sum>
+void HoppingMedianFilter<T, Sum>::getQuantiles(const double * p, Sum * quantiles, size_t count)
+{
+   for(size_t i = 0; i < count; i++)
+   {
+      quantiles[i] = getQuantile(p[i]);
+   }
+}
+
+template <typename T, typename Sum>
+size_t HoppingMedianFilter<T, Sum>::getHop() const
+{
+   return hopSize;
+}
+
+template <typename T, typename Sum>
+size_t HoppingMedianFilter<T, Sum>::pending() const
+{
+   return taken;
+}
+
+template <typename T, typename Sum>
+void HoppingMedianFilter<T, Sum>::reset(T seed)
+{
+   oldestDataPoint = 0;
+   taken = 0;
+   median = seed;
+
+   for(size_t i = 0; i < medFilterWin; i++) // initialize the arrays
+   {
+      data[i]   = seed;   // populate with seed value
+      window[i] = seed;
+   }
+}
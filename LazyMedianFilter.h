@@ -0,0 +1,110 @@
+/*
+  LazyMedianFilter.h - Median filter that defers ordering until it is queried, for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   A LazyMedianFilter holds the same sliding window as MedianFilter, but in() only stores the sample in the ring buffer.
+   The order is rebuilt when a statistic is asked for, so a channel sampled far more often than it is read pays almost
+   nothing per sample:
+
+      LazyMedianFilter<int16_t, int32_t> filter(255, 0);
+      filter.in(samples, count);   // ISR or DMA buffer, a copy into the ring buffer
+      int16_t median = filter.out();
+
+   A query rebuilds from the samples written since the last one:
+      - none:                                   the cached order is used, O(1)
+      - up to size / MEDIAN_FILTER_LAZY_RESORT: the changed samples are sorted and merged into the sorted order, O(size + c log c)
+      - more:                                   out() selects the median with std::nth_element, O(size);
+                                                getRank() and the quantiles sort the whole window, O(size log size)
+   getMin() and getMax() scan the ring buffer when the order is stale, getMean() always sums it, O(size).
+
+   Eager MedianFilter pays for the order on every sample and answers in O(1), so the lazy filter wins once enough samples
+   arrive per query: about 16 for windows of 31 to 255 and 64 for 1023 with random int32 samples (the lazyN operations of
+   bench/median_filter_bench.cpp).  Queries reorder internal buffers, so const methods must not be called from several
+   threads at once.  NaN samples sort above every number.  The median of
+   an even window is the upper one of the middle pair, like MedianFilter.
+ */
+
+#ifndef LazyMedianFilter_h
+
+   #define LazyMedianFilter_h
+
+   #include "MedianFilter.h"
+
+   #ifndef MEDIAN_FILTER_LAZY_RESORT
+      #define MEDIAN_FILTER_LAZY_RESORT 8   // incremental re-sort while at most window / this many samples changed
+   #endif
+
+   template <typename T, typename Sum, typename Index = uint16_t>
+   class LazyMedianFilter
+   {
+      static_assert(std::numeric_limits<Index>::is_integer && !std::numeric_limits<Index>::is_signed, "Index must be an unsigned integer type");
+
+      public:
+         LazyMedianFilter(size_t size, T seed);
+         LazyMedianFilter(const LazyMedianFilter<T, Sum, Index> &other);
+         LazyMedianFilter(LazyMedianFilter<T, Sum, Index> &&other);
+         ~LazyMedianFilter();
+
+         void in(const T & value);                // store value, O(1)
+         void in(const T * src, size_t n);        // store a buffer, n copies
+         T out() const;
+
+         T getMin() const;
+         T getMax() const;
+         Sum getMean() const;
+
+         T getRank(size_t k) const;              // k-th smallest sample, 0 is getMin(), size - 1 is getMax()
+         Sum getQuantile(double p) const;         // p in [0, 1], linear interpolation between ranks
+         void getQuantiles(const double * p, Sum * quantiles, size_t count) const;
+
+         void reset(T seed);
+
+         LazyMedianFilter<T, Sum, Index>& operator=(const LazyMedianFilter<T, Sum, Index>&);
+         LazyMedianFilter<T, Sum, Index>& operator=(LazyMedianFilter<T, Sum, Index>&&);
+
+      private:
+         typedef median_filter_detail::SortedRecord<T, Index> Record;
+
+         enum class Order : uint8_t
+         {
+            Sorted,        // records sorted by value
+            Partitioned    // records partitioned around the median by nth_element
+         };
+
+         Index medFilterWin;               // number of samples in sliding median filter window
+         Index oldestDataPoint;            // oldest data point location in ring buffer, the next slot to write
+         T * data;                         // array pointer for data sorted by age in ring buffer
+         Record * records;                 // the window at the last rebuild, value and ring slot
+         Record * fresh;                   // changed samples during an incremental re-sort
+         mutable Index rebuildPoint;       // oldestDataPoint at the last rebuild
+         mutable Index changed;            // slots written since the last rebuild, saturates at the window
+         mutable Order order;
+
+         Index resortLimit() const;
+         void allocate();
+         void release();
+         void copyFrom(const LazyMedianFilter<T, Sum, Index> &other);
+         void gather() const;              // records from the whole ring buffer
+         void resort() const;
+         void select() const;
+         void sort() const;
+   };
+
+#include "LazyMedianFilter.hpp"
+
+#endif
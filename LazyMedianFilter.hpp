@@ -0,0 +1,311 @@
+/*
+   LazyMedianFilter.hpp - Median filter that defers ordering until it is queried, for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "LazyMedianFilter.h"
+
+#include <algorithm>
+
+template <typename T, typename Sum, typename Index>
+LazyMedianFilter<T, Sum, Index>::LazyMedianFilter(size_t size, T seed)
+{
+   medFilterWin = median_filter_detail::clamp(size, (size_t) 3, (size_t) std::numeric_limits<Index>::max());   // same minimum as MedianFilter, at most the Index maximum
+
+   allocate();
+   reset(seed);
+}
+
+template <typename T, typename Sum, typename Index>
+LazyMedianFilter<T, Sum, Index>::LazyMedianFilter(const LazyMedianFilter<T, Sum, Index> &other) :
+   medFilterWin { other.medFilterWin } {
+   allocate();
+   copyFrom(other);
+}
+
+template <typename T, typename Sum, typename Index>
+LazyMedianFilter<T, Sum, Index>& LazyMedianFilter<T, Sum, Index>::operator=(const LazyMedianFilter<T, Sum, Index>& other) {
+   if(this == &other) return *this;
+
+   release();
+   medFilterWin = other.medFilterWin;
+   allocate();
+   copyFrom(other);
+
+   return *this;
+}
+
+template <typename T, typename Sum, typename Index>
+LazyMedianFilter<T, Sum, Index>::LazyMedianFilter(LazyMedianFilter<T, Sum, Index> &&other) :
+   medFilterWin { other.medFilterWin },
+   oldestDataPoint { other.oldestDataPoint },
+   data { other.data },
+   records { other.records },
+   fresh { other.fresh },
+   rebuildPoint { other.rebuildPoint },
+   changed { other.changed },
+   order { other.order } {
+   other.data = nullptr;
+   other.records = nullptr;
+   other.fresh = nullptr;
+}
+
+template <typename T, typename Sum, typename Index>
+LazyMedianFilter<T, Sum, Index>& LazyMedianFilter<T, Sum, Index>::operator=(LazyMedianFilter<T, Sum, Index>&& other) {
+   if(this == &other) return *this;
+
+   release();
+   medFilterWin = other.medFilterWin;
+   oldestDataPoint = other.oldestDataPoint;
+   data = other.data;
+   records = other.records;
+   fresh = other.fresh;
+   rebuildPoint = other.rebuildPoint;
+   changed = other.changed;
+   order = other.order;
+   other.data = nullptr;
+   other.records = nullptr;
+   other.fresh = nullptr;
+   return *this;
+}
+
+template <typename T, typename Sum, typename Index>
+LazyMedianFilter<T, Sum, Index>::~LazyMedianFilter()
+{
+   release();
+}
+
+template <typename T, typename Sum, typename Index>
+Index LazyMedianFilter<T, Sum, Index>::resortLimit() const
+{
+   return medFilterWin / MEDIAN_FILTER_LAZY_RESORT;
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::allocate()
+{
+   data    = (T*) calloc (medFilterWin, sizeof(T));                         // array for data
+   records = (Record*) calloc (medFilterWin, sizeof(Record));               // array for the ordered window
+   fresh   = (Record*) calloc ((size_t) resortLimit() + 1, sizeof(Record));   // array for the samples of an incremental re-sort
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::release()
+{
+   free(data);
+   free(records);
+   free(fresh);
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::copyFrom(const LazyMedianFilter<T, Sum, Index> &other)
+{
+   oldestDataPoint = other.oldestDataPoint;
+   rebuildPoint = other.rebuildPoint;
+   changed = other.changed;
+   order = other.order;
+   memcpy(data, other.data, medFilterWin * sizeof(T));
+   memcpy(records, other.records, medFilterWin * sizeof(Record));
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::in(const T & value)
+{
+   data[oldestDataPoint] = value;
+   if(++oldestDataPoint == medFilterWin) oldestDataPoint = 0;
+   if(changed < medFilterWin) changed++;
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::in(const T * src, size_t n)
+{
+   if(n == 0) return;
+   if(n >= medFilterWin)   // only the last window of the buffer survives
+   {
+      src += n - medFilterWin;
+      n = medFilterWin;
+   }
+
+   const size_t first = std::min(n, (size_t) (medFilterWin - oldestDataPoint));   // up to the end of the ring, then from its start
+   memcpy(data + oldestDataPoint, src, first * sizeof(T));
+   memcpy(data, src + first, (n - first) * sizeof(T));
+
+   oldestDataPoint = (Index) ((oldestDataPoint + n) % medFilterWin);
+   changed = (Index) std::min((size_t) medFilterWin, (size_t) changed + n);
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::gather() const
+{
+   for(Index i = 0; i < medFilterWin; i++)
+   {
+      records[i].value = data[i];
+      records[i].slot  = i;
+   }
+   rebuildPoint = oldestDataPoint;
+   changed = 0;
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::resort() const
+{
+   auto less = [](const Record & a, const Record & b) { return median_filter_detail::ordered_less(a.value, b.value); };
+
+   const Index count = changed;
+
+   // drop the records of the slots written since the last rebuild, [rebuildPoint, rebuildPoint + count) around the ring
+   Index kept = 0;
+   for(Index i = 0; i < medFilterWin; i++)
+   {
+      const Index slot = records[i].slot;
+      const Index age  = (slot >= rebuildPoint) ? slot - rebuildPoint : slot + (medFilterWin - rebuildPoint);
+      records[kept] = records[i];
+      kept += (age >= count);
+   }
+
+   Index slot = rebuildPoint;
+   for(Index i = 0; i < count; i++)
+   {
+      fresh[i].value = data[slot];
+      fresh[i].slot  = slot;
+      if(++slot == medFilterWin) slot = 0;
+   }
+   std::sort(fresh, fresh + count, less);
+
+   // merge from the back, the kept records move up into the room the dropped ones left
+   size_t a = kept, b = count, k = medFilterWin;
+   while(b > 0)
+   {
+      if(a > 0 && less(fresh[b - 1], records[a - 1])) records[--k] = records[--a];
+      else records[--k] = fresh[--b];
+   }
+
+   rebuildPoint = oldestDataPoint;
+   changed = 0;
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::select() const
+{
+   auto less = [](const Record & a, const Record & b) { return median_filter_detail::ordered_less(a.value, b.value); };
+
+   gather();
+   std::nth_element(records, records + medFilterWin / 2, records + medFilterWin, less);
+   order = Order::Partitioned;
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::sort() const
+{
+   auto less = [](const Record & a, const Record & b) { return median_filter_detail::ordered_less(a.value, b.value); };
+
+   if(order == Order::Sorted && changed == 0) return;
+
+   if(order == Order::Sorted && changed <= resortLimit())
+   {
+      resort();
+      return;
+   }
+
+   if(changed > 0) gather();
+   std::sort(records, records + medFilterWin, less);
+   order = Order::Sorted;
+}
+
+template <typename T, typename Sum, typename Index>
+T LazyMedianFilter<T, Sum, Index>::out() const
+{
+   if(changed > 0)
+   {
+      if(order == Order::Sorted && changed <= resortLimit()) resort();
+      else select();
+   }
+   return records[medFilterWin / 2].value;
+}
+
+template <typename T, typename Sum, typename Index>
+T LazyMedianFilter<T, Sum, Index>::getMin() const
+{
+   if(order == Order::Sorted && changed == 0) return records[0].value;
+
+   T lowest = data[0];
+   for(Index i = 1; i < medFilterWin; i++)
+   {
+      if(median_filter_detail::ordered_less(data[i], lowest)) lowest = data[i];
+   }
+   return lowest;
+}
+
+template <typename T, typename Sum, typename Index>
+T LazyMedianFilter<T, Sum, Index>::getMax() const
+{
+   if(order == Order::Sorted && changed == 0) return records[medFilterWin - 1].value;
+
+   T highest = data[0];
+   for(Index i = 1; i < medFilterWin; i++)
+   {
+      if(median_filter_detail::ordered_less(highest, data[i])) highest = data[i];
+   }
+   return highest;
+}
+
+template <typename T, typename Sum, typename Index>
+Sum LazyMedianFilter<T, Sum, Index>::getMean() const
+{
+   Sum totalSum = 0;
+   for(Index i = 0; i < medFilterWin; i++) totalSum += (Sum) data[i];
+   return totalSum / (Sum) medFilterWin;
+}
+
+template <typename T, typename Sum, typename Index>
+T LazyMedianFilter<T, Sum, Index>::getRank(size_t k) const
+{
+   if(k >= medFilterWin) k = medFilterWin - 1;
+
+   sort();
+   return records[k].value;
+}
+
+template <typename T, typename Sum, typename Index>
+Sum LazyMedianFilter<T, Sum, Index>::getQuantile(double p) const
+{
+   const median_filter_detail::QuantilePosition q(p, medFilterWin);
+
+   if(q.fraction == 0.0) return (Sum) getRank(q.rank);
+   return median_filter_detail::interpolate<Sum>(getRank(q.rank), getRank(q.rank + 1), q.fraction);
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::getQuantiles(const double * p, Sum * quantiles, size_t count) const
+{
+   for(size_t i = 0; i < count; i++)
+   {
+      quantiles[i] = getQuantile(p[i]);
+   }
+}
+
+template <typename T, typename Sum, typename Index>
+void LazyMedianFilter<T, Sum, Index>::reset(T seed)
+{
+   oldestDataPoint = 0;
+
+   for(Index i = 0; i < medFilterWin; i++) // initialize the arrays
+   {
+      data[i] = seed;   // populate with seed value
+   }
+   gather();
+   order = Order::Sorted;
+}
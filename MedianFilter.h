@@ -1,80 +1,356 @@
-/*
-  MedianFilter.h - Median Filter for the Arduino platform.
-  Copyright (c) 2013 Phillip Schmidt.  All right reserved.
-
-  This library is free software; you can redistribute it and/or
-  modify it under the terms of the GNU Lesser General Public
-  License as published by the Free Software Foundation; either
-  version 2.1 of the License, or (at your option) any later version.
-
-  This library is distributed in the hope that it will be useful,
-  but WITHOUT ANY WARRANTY; without even the implied warranty of
-  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-  Lesser General Public License for more details.
-
-  You should have received a copy of the GNU Lesser General Public
-  License along with this library; if not, write to the Free Software
-  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
-*/
-
-/*
-   A median filter object is created by by passing the desired filter window size on object creation.
-   The window size should be an odd number between 3 and 255.
-
-   New data is added to the median filter by passing the data through the in() function.  The new medial value is returned.
-   The new data will over-write the oldest data point, then be shifted in the array to place it in the correct location.
-
-   The current median value is returned by the out() function for situations where the result is desired without passing in new data.
-
-   !!! All data must be type INT.  !!!
- */
-
-#ifndef MedianFilter_h
-
-   #define MedianFilter_h
-
-   #include "Arduino.h"
-
-   template <typename T, typename Sum>
-   class MedianFilter
-   {
-      public:
-         MedianFilter(int size, T seed);
-         MedianFilter(const MedianFilter<T, Sum> &other);
-         MedianFilter(MedianFilter<T, Sum> &&other);
-         ~MedianFilter();
-         T in(const T & value);
-         T out() const;
-
-         T getMin() const;
-         T getMax() const;
-         Sum getMean() const;
-         Sum getStdDev() const;
-
-         void reset(T seed);
-
-         MedianFilter<T, Sum>& operator=(const MedianFilter<T, Sum>&);
-         MedianFilter<T, Sum>& operator=(MedianFilter<T, Sum>&&);
-
-         /*
-         void printData();		// used for debugging
-         void printSizeMap();
-         void printLocationMap();
-         void printSortedData();
-         */
-
-      private:
-         uint8_t medFilterWin;      // number of samples in sliding median filter window - usually odd #
-         uint8_t medDataPointer;	   // mid point of window
-         T * data;			   // array pointer for data sorted by age in ring buffer
-         uint8_t  * sizeMap;			// array pointer for locations data in sorted by size
-         uint8_t  * locationMap;		// array pointer for data locations in history map
-         uint8_t oldestDataPoint;	// oldest data point location in ring buffer
-         Sum totalSum;
-
-         bool is_valid_value(T v);
-   };
-
-#include "MedianFilter.hpp"
-
-#endif
+/*
+  MedianFilter.h - Median Filter for the Arduino platform.
+  Copyright (c) 2013 Phillip Schmidt.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   A median filter object is created by by passing the desired filter window size on object creation.
+   The window size should be an odd number between 3 and the largest value of the Index type (255 for the default uint8_t).
+   Larger windows are available by selecting a wider Index type, e.g. MedianFilter<int, long, uint16_t> for up to 65535 samples
+   or MedianFilter<int, long, uint32_t> for windows up to 2^32 - 1.  The maps grow by sizeof(Index) bytes per window unit.
+
+   All state lives in one block from the Allocator template argument (calloc by default, any standard allocator such as
+   std::pmr::polymorphic_allocator<unsigned char> works).  Arduino builds take the block from new[] and ignore Allocator.  Copy assignment reuses the block when it is large enough for the
+   source filter.  Like the standard containers with the default propagation traits, assignment keeps the target's allocator;
+   a move between unequal allocators copies.
+
+   New data is added to the median filter by passing the data through the in() function.  The new medial value is returned.
+   The new data will over-write the oldest data point, then be shifted in the array to place it in the correct location.
+
+   The current median value is returned by the out() function for situations where the result is desired without passing in new data.
+   Any other order statistic is available from getRank(k), and interpolated percentiles from getQuantile(p) / getQuantiles().
+   getMAD() returns the median absolute deviation from the median, selected from the sorted order in O(log window) rank reads.
+   sorted() and byAge() are allocation free ranges over the current window, smallest first and oldest first.  They read the
+   filter in place and are invalidated by the next in() or reset().
+
+   Five update engines are available behind the same interface:
+      MedianFilterEngine::Sorted    - the sorted map is shifted one neighbour at a time, O(window) per sample, smallest memory use.
+      MedianFilterEngine::Interleaved - as Sorted, but the sorted order is an array of { value, slot } records starting on a
+                                      cache line, so a shift compares and moves one compact record instead of chasing
+                                      data[sizeMap[n]] and locationMap[sizeMap[n]] through three arrays.
+      MedianFilterEngine::Tree      - samples live in an order statistic tree (treap) keyed by ring buffer slot, O(log window) per sample.
+      MedianFilterEngine::Histogram - one counter per possible sample value and a cursor parked on the median bin, O(1) amortised
+                                      per sample at any window size.  Integer T of 16 bits or less only; the counters take
+                                      (2^bits + 2^(bits/2)) * sizeof(Index) bytes, e.g. 132 kB for int16_t samples with a uint16_t Index.
+      MedianFilterEngine::Network   - windows of 3, 5, 7 and 9 samples only.  No maps: the median is taken from the ring buffer with the
+                                      branch free selection networks of MedianFilterNetwork.h, and getRank(), getMAD() and sorted() sort a
+                                      copy of the (at most 9 sample) window when asked.  Results match Sorted for integer samples and for
+                                      floating point samples without NaN.
+   MedianFilterEngine::Auto (default) picks the network for windows of 3, 5, 7 and 9 samples, keeps the sorted map for the other windows
+   below MEDIAN_FILTER_TREE_THRESHOLD samples and uses the tree above it.  Asking for the network with any other window falls back to Auto.
+   The histogram engine is never chosen automatically; asking for it with a wider T falls back to Auto.
+
+   !!! All data must be type INT.  !!!
+ */
+
+#ifndef MedianFilter_h
+
+   #define MedianFilter_h
+
+   #include "MedianFilterPlatform.h"
+
+   #include <stddef.h>
+   #include <stdint.h>
+
+   #if !MEDIAN_FILTER_ARDUINO
+      #include <memory>
+   #endif
+
+   #include "MedianFilterTree.h"
+   #include "MedianFilterHistogram.h"
+   #include "MedianFilterNetwork.h"
+
+   #ifndef MEDIAN_FILTER_TREE_THRESHOLD
+      #define MEDIAN_FILTER_TREE_THRESHOLD 256   // smallest window handled by the tree engine when MedianFilterEngine::Auto is selected
+   #endif
+
+   #if __cplusplus >= 201703L
+      #define MEDIAN_FILTER_CONSTEXPR constexpr
+   #else
+      #define MEDIAN_FILTER_CONSTEXPR
+   #endif
+
+   #ifndef MEDIAN_FILTER_CACHE_LINE
+      #define MEDIAN_FILTER_CACHE_LINE 64   // alignment of the interleaved engine's records, in bytes
+   #endif
+
+   #ifndef MEDIAN_FILTER_STDDEV_RESYNC
+      #define MEDIAN_FILTER_STDDEV_RESYNC 0   // default number of updates between exact re-sums of the running variance, 0 = never
+   #endif
+
+   namespace median_filter_detail
+   {
+      // variance of a sliding window kept up to date per sample (Welford's update for a replaced sample), so getStdDev() is O(1)
+      struct RunningVariance
+      {
+         double mean = 0.0;
+         double m2 = 0.0;           // sum of squared differences from mean
+         size_t invalid = 0;        // NaN samples in the window, the variance is NaN while there are any
+         uint32_t resyncInterval = MEDIAN_FILTER_STDDEV_RESYNC;   // updates between exact re-sums bounding rounding drift, 0 = never
+         uint32_t sinceResync = 0;
+
+         template <typename T> MEDIAN_FILTER_CONSTEXPR void reset(const T & seed, size_t n);
+         template <typename T> void update(const T & old, const T & value, const T * data, size_t n);
+         template <typename T> void resum(const T * data, size_t n);
+         double variance(size_t n) const;
+      };
+
+      // position p * (n - 1) of a sorted window, split in the lower rank and the fraction towards the next one
+      struct QuantilePosition
+      {
+         size_t rank;
+         double fraction;
+
+         QuantilePosition(double p, size_t n);
+      };
+
+      template <typename Sum, typename Rank>
+      Sum median_absolute_deviation(const Rank & rank, size_t n);
+
+      // one entry of the interleaved engine's sorted order
+      template <typename T, typename Index>
+      struct SortedRecord
+      {
+         T value;
+         Index slot;   // ring buffer slot the value came from
+      };
+
+      template <typename T>
+      void sorted_copy(const T * data, size_t n, T * sorted);
+
+      template <typename T, typename Index>
+      void interleaved_update(SortedRecord<T, Index> * records, Index * locationMap, Index medFilterWin, Index slot, const T & value);
+
+      // allocation unit of a filter's storage block, aligned for both the samples and the maps
+      template <typename T, typename Index>
+      union StorageUnit
+      {
+         T sample;
+         Index index;
+      };
+
+      // Arduino builds allocate with new[] / delete[] and leave Allocator unused, there is no std::allocator_traits on AVR
+      template <typename Unit>
+      struct NewArrayTraits
+      {
+         template <typename A> static Unit * allocate(A &, size_t n) { return new Unit[n]; }
+         template <typename A> static void deallocate(A &, Unit * p, size_t) { delete[] p; }
+         template <typename A> static A select_on_container_copy_construction(const A & a) { return a; }
+      };
+
+      // default filter allocator, calloc / free like the rest of the library
+      template <typename T>
+      struct CallocAllocator
+      {
+         typedef T value_type;
+
+         CallocAllocator() {}
+         template <typename U> CallocAllocator(const CallocAllocator<U> &) {}
+
+         T * allocate(size_t n) { return (T*) calloc(n, sizeof(T)); }
+         void deallocate(T * p, size_t) { free(p); }
+
+         template <typename U> bool operator==(const CallocAllocator<U> &) const { return true; }
+         template <typename U> bool operator!=(const CallocAllocator<U> &) const { return false; }
+      };
+   }
+
+   enum class MedianFilterEngine : uint8_t
+   {
+      Auto,       // Network for 3, 5, 7 and 9 samples, Sorted below MEDIAN_FILTER_TREE_THRESHOLD, Tree at and above it
+      Sorted,     // insertion sort through the size map, O(window) per sample
+      Tree,       // order statistic treap, O(log window) per sample
+      Histogram,  // counting histogram with a median cursor, O(1) amortised per sample, T of 16 bits or less
+      Interleaved, // insertion sort over { value, slot } records, O(window) per sample
+      Network     // selection network over the ring buffer, windows of 3, 5, 7 and 9 samples only
+   };
+
+   template <typename T, typename Sum, typename Index = uint8_t, typename Allocator = median_filter_detail::CallocAllocator<unsigned char> >
+   class MedianFilter
+   {
+      static_assert(median_filter_detail::limits<Index>::is_integer && !median_filter_detail::limits<Index>::is_signed, "Index must be an unsigned integer type");
+
+      public:
+         typedef Allocator allocator_type;
+
+         MedianFilter(ptrdiff_t size, T seed, MedianFilterEngine engine = MedianFilterEngine::Auto, const Allocator & allocator = Allocator());
+         MedianFilter(const MedianFilter<T, Sum, Index, Allocator> &other);
+         MedianFilter(MedianFilter<T, Sum, Index, Allocator> &&other);
+         ~MedianFilter();
+         T in(const T & value);
+         void in(const T * src, T * dst, size_t n);   // filter a buffer, dst[i] is what in(src[i]) would return; dst may equal src
+         T out() const;
+
+         T getMin() const;
+         T getMax() const;
+         Sum getMean() const;
+         Sum getStdDev() const;
+         Sum getMAD() const;                      // median absolute deviation, median of |sample - out()|
+
+         T getRank(size_t k) const;              // k-th smallest sample, 0 is getMin(), window - 1 is getMax()
+         Sum getQuantile(double p) const;         // p in [0, 1], linear interpolation between ranks
+         void getQuantiles(const double * p, Sum * quantiles, size_t count) const;
+
+         void reset(T seed);
+
+         class SortedIterator   // walks data[sizeMap[0]] .. data[sizeMap[window - 1]], or the tree or histogram in order
+         {
+            public:
+               typedef median_filter_detail::forward_iterator_tag iterator_category;
+               typedef T value_type;
+               typedef ptrdiff_t difference_type;
+               typedef const T * pointer;
+               typedef const T & reference;
+
+               SortedIterator(const MedianFilter<T, Sum, Index, Allocator> * filter, size_t position, Index node) :
+                  filter { filter }, position { position }, node { node }, cursor { 0, 0 }, value {} { settle(); }
+
+               const T & operator*() const
+               {
+                  if(filter->engine == MedianFilterEngine::Histogram || filter->engine == MedianFilterEngine::Network) return value;
+                  if(filter->engine == MedianFilterEngine::Interleaved) return filter->records[position].value;
+                  return filter->data[filter->engine == MedianFilterEngine::Tree ? node : filter->sizeMap[position]];
+               }
+               const T * operator->() const { return &**this; }
+               SortedIterator & operator++() { if(filter->engine == MedianFilterEngine::Tree) node = filter->tree.next(node); position++; settle(); return *this; }
+               SortedIterator operator++(int) { SortedIterator previous = *this; ++*this; return previous; }
+               bool operator==(const SortedIterator & other) const { return position == other.position; }
+               bool operator!=(const SortedIterator & other) const { return position != other.position; }
+
+            private:
+               const MedianFilter<T, Sum, Index, Allocator> * filter;
+               size_t position;   // rank of the current sample
+               Index node;        // slot of the current sample, tree engine only
+               median_filter_detail::HistogramCursor cursor;   // bin of the current sample, histogram engine only
+               T value;                                         // ... and its value, also the network engine's current sample
+
+               void settle()
+               {
+                  if(position >= filter->medFilterWin) return;
+                  if(filter->engine == MedianFilterEngine::Network) value = filter->getRank(position);
+                  if(filter->engine != MedianFilterEngine::Histogram) return;
+                  filter->histogram.seek(cursor, position);
+                  value = filter->histogram.value(cursor.bin);
+               }
+         };
+
+         class AgeIterator   // walks the ring buffer from the oldest sample to the newest
+         {
+            public:
+               typedef median_filter_detail::forward_iterator_tag iterator_category;
+               typedef T value_type;
+               typedef ptrdiff_t difference_type;
+               typedef const T * pointer;
+               typedef const T & reference;
+
+               AgeIterator(const MedianFilter<T, Sum, Index, Allocator> * filter, size_t position) :
+                  filter { filter }, position { position } {}
+
+               const T & operator*() const
+               {
+                  size_t slot = filter->oldestDataPoint + position;
+                  if(slot >= filter->medFilterWin) slot -= filter->medFilterWin;
+                  return filter->data[slot];
+               }
+               const T * operator->() const { return &**this; }
+               AgeIterator & operator++() { position++; return *this; }
+               AgeIterator operator++(int) { AgeIterator previous = *this; ++*this; return previous; }
+               bool operator==(const AgeIterator & other) const { return position == other.position; }
+               bool operator!=(const AgeIterator & other) const { return position != other.position; }
+
+            private:
+               const MedianFilter<T, Sum, Index, Allocator> * filter;
+               size_t position;   // age of the current sample, 0 is the oldest
+         };
+
+         template <typename Iterator>
+         class View
+         {
+            public:
+               View(Iterator first, Iterator last, size_t count) : first { first }, last { last }, count { count } {}
+
+               Iterator begin() const { return first; }
+               Iterator end() const { return last; }
+               size_t size() const { return count; }
+
+            private:
+               Iterator first;
+               Iterator last;
+               size_t count;
+         };
+
+         View<SortedIterator> sorted() const;   // smallest sample first
+         View<AgeIterator> byAge() const;       // oldest sample first
+
+         MedianFilterEngine getEngine() const;
+         allocator_type get_allocator() const;
+         void setStdDevResync(uint32_t updates);   // re-sum the variance exactly every `updates` samples, 0 = never
+
+         MedianFilter<T, Sum, Index, Allocator>& operator=(const MedianFilter<T, Sum, Index, Allocator>&);
+         MedianFilter<T, Sum, Index, Allocator>& operator=(MedianFilter<T, Sum, Index, Allocator>&&);
+
+         /*
+         void printData();		// used for debugging
+         void printSizeMap();
+         void printLocationMap();
+         void printSortedData();
+         */
+
+      private:
+         typedef median_filter_detail::StorageUnit<T, Index> Unit;
+      #if MEDIAN_FILTER_ARDUINO
+         typedef Allocator UnitAllocator;
+         typedef median_filter_detail::NewArrayTraits<Unit> UnitTraits;
+      #else
+         typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Unit> UnitAllocator;
+         typedef std::allocator_traits<UnitAllocator> UnitTraits;
+      #endif
+
+         UnitAllocator allocator;
+         Unit * storage;            // one block holding every array below
+         size_t storageSize;        // units in storage, at least storageNeeded()
+
+         Index medFilterWin;      // number of samples in sliding median filter window - usually odd #
+         Index medDataPointer;	   // mid point of window
+         T * data;			   // array pointer for data sorted by age in ring buffer
+         Index  * sizeMap;			// array pointer for locations data in sorted by size
+         Index  * locationMap;		// array pointer for data locations in history map
+         median_filter_detail::SortedRecord<T, Index> * records;   // interleaved engine only, sorted order with the values inline
+         Index oldestDataPoint;	// oldest data point location in ring buffer
+         Sum totalSum;
+         median_filter_detail::RunningVariance runningVariance;
+
+         MedianFilterEngine engine;   // never Auto once constructed
+         median_filter_detail::SlotTree<T, Index> tree;   // tree engine only, links are null for the other engines
+         median_filter_detail::CountingHistogram<T, Index> histogram;   // histogram engine only, counts are null for the other engines
+         median_filter_detail::HistogramCursor medianCursor;            // parked on the bin of the median
+
+         static bool is_valid_value(T v);
+
+         size_t storageNeeded() const;   // in units
+         void allocate();   // makes storage fit the window and engine, reusing the current block when it is large enough
+         void release();
+         void copyFrom(const MedianFilter<T, Sum, Index, Allocator> &other);
+         void sortedUpdate(Index slot);
+
+         template <bool CheckValid>
+         void inBlock(const T * src, T * dst, size_t n);
+   };
+
+#include "MedianFilter.hpp"
+
+#endif
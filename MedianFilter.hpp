@@ -19,7 +19,7 @@
 
 /*
     A median filter object is created by by passing the desired filter window size on object creation.
-   The window size should be an odd number between 3 and 255.
+   The window size should be an odd number between 3 and the largest value of the Index type (255 for uint8_t).
 
    New data is added to the median filter by passing the data through the in() function.  The new medial value is returned.
    The new data will over-write the oldest data point, then be shifted in the array to place it in the correct location.
@@ -35,255 +35,859 @@
    11 / 49
    21 / 99
 
+   Host timings for every engine, sample type and input come from the median_filter_bench target.
+
 */
 
 #include "MedianFilter.h"
 
-#include <cmath>
-
-template <typename T, typename Sum>
-MedianFilter<T, Sum>::MedianFilter(int size, T seed)
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianFilter<T, Sum, Index, Allocator>::MedianFilter(ptrdiff_t size, T seed, MedianFilterEngine engine, const Allocator & allocator) :
+   allocator ( allocator ),
+   storage { nullptr },
+   storageSize { 0 }
 {
-   medFilterWin    = constrain(size, 3, 255); // number of samples in sliding median filter window - usually odd #
+   if(size < 3) size = 3;                         // also catches a negative size before it is widened
+   medFilterWin    = median_filter_detail::clamp((size_t) size, (size_t) 3, (size_t) median_filter_detail::limits<Index>::highest()); // number of samples in sliding median filter window - usually odd #
    medDataPointer  = medFilterWin >> 1;           // mid point of window
-   data            = (T*) calloc (medFilterWin, sizeof(T)); // array for data
-   sizeMap         = (uint8_t*) calloc (medFilterWin, sizeof(uint8_t)); // array for locations of data in sorted list
-   locationMap     = (uint8_t*) calloc (medFilterWin, sizeof(uint8_t)); // array for locations of history data in map list
-   oldestDataPoint = medDataPointer;      // oldest data point location in data array
-   totalSum        = medFilterWin * ((Sum) seed);         // total of all values
 
-   for(uint8_t i = 0; i < medFilterWin; i++) // initialize the arrays
+   if(engine == MedianFilterEngine::Histogram && !median_filter_detail::CountingHistogram<T, Index>::available)
    {
-      sizeMap[i]     = i;      // start map with straight run
-      locationMap[i] = i;      // start map with straight run
-      data[i]        = seed;   // populate with seed value
+      engine = MedianFilterEngine::Auto;   // no histogram for samples wider than 16 bits
+   }
+   if(engine == MedianFilterEngine::Network && !median_filter_detail::is_network_window(medFilterWin))
+   {
+      engine = MedianFilterEngine::Auto;   // the networks only exist for 3, 5, 7 and 9 samples
    }
+   if(engine == MedianFilterEngine::Auto)
+   {
+      engine = medFilterWin >= MEDIAN_FILTER_TREE_THRESHOLD ? MedianFilterEngine::Tree : MedianFilterEngine::Sorted;
+      if(median_filter_detail::is_network_window(medFilterWin)) engine = MedianFilterEngine::Network;
+   }
+   this->engine = engine;
+
+   allocate();
+   reset(seed);
 }
 
-template <typename T, typename Sum>
-MedianFilter<T, Sum>::MedianFilter(const MedianFilter<T, Sum> &other) :
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianFilter<T, Sum, Index, Allocator>::MedianFilter(const MedianFilter<T, Sum, Index, Allocator> &other) :
+   allocator ( UnitTraits::select_on_container_copy_construction(other.allocator) ),
+   storage { nullptr },
+   storageSize { 0 },
    medFilterWin { other.medFilterWin },
    medDataPointer { other.medDataPointer },
-   oldestDataPoint { other.oldestDataPoint },
-   totalSum { other.totalSum } {
-   data            = (T*) calloc (medFilterWin, sizeof(T)); // array for data
-   sizeMap         = (uint8_t*) calloc (medFilterWin, sizeof(uint8_t)); // array for locations of data in sorted list
-   locationMap     = (uint8_t*) calloc (medFilterWin, sizeof(uint8_t)); // array for locations of history data in map list
-   memcpy(data, other.data, medFilterWin * sizeof(T));
-   memcpy(sizeMap, other.sizeMap, medFilterWin * sizeof(uint8_t));
-   memcpy(locationMap, other.locationMap, medFilterWin * sizeof(uint8_t));
+   engine { other.engine } {
+   allocate();
+   copyFrom(other);
 }
 
-template <typename T, typename Sum>
-MedianFilter<T, Sum>& MedianFilter<T, Sum>::operator=(const MedianFilter<T, Sum>& other) {
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianFilter<T, Sum, Index, Allocator>& MedianFilter<T, Sum, Index, Allocator>::operator=(const MedianFilter<T, Sum, Index, Allocator>& other) {
+   if(this == &other) return *this;
+
    medFilterWin = other.medFilterWin;
    medDataPointer = other.medDataPointer;
-   oldestDataPoint = other.oldestDataPoint;
-   totalSum = other.totalSum;
-   free(data);
-   free(sizeMap);
-   free(locationMap);
-   data            = (T*) calloc (medFilterWin, sizeof(T)); // array for data
-   sizeMap         = (uint8_t*) calloc (medFilterWin, sizeof(uint8_t)); // array for locations of data in sorted list
-   locationMap     = (uint8_t*) calloc (medFilterWin, sizeof(uint8_t)); // array for locations of history data in map list
-   memcpy(data, other.data, medFilterWin * sizeof(T));
-   memcpy(sizeMap, other.sizeMap, medFilterWin * sizeof(uint8_t));
-   memcpy(locationMap, other.locationMap, medFilterWin * sizeof(uint8_t));
+   engine = other.engine;
+   allocate();   // keeps the current block when it is large enough
+   copyFrom(other);
 
    return *this;
 }
 
-template <typename T, typename Sum>
-MedianFilter<T, Sum>::MedianFilter(MedianFilter<T, Sum> &&other) :
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianFilter<T, Sum, Index, Allocator>::MedianFilter(MedianFilter<T, Sum, Index, Allocator> &&other) :
+   allocator ( other.allocator ),
+   storage { other.storage },
+   storageSize { other.storageSize },
    medFilterWin { other.medFilterWin },
    medDataPointer { other.medDataPointer },
    data { other.data },
    sizeMap { other.sizeMap },
    locationMap { other.locationMap },
+   records { other.records },
    oldestDataPoint { other.oldestDataPoint },
-   totalSum { other.totalSum } {
-   other.data = nullptr;
-   other.sizeMap = nullptr;
-   other.locationMap = nullptr;
+   totalSum { other.totalSum },
+   runningVariance ( other.runningVariance ),
+   engine { other.engine },
+   tree ( other.tree ),
+   histogram ( other.histogram ),
+   medianCursor ( other.medianCursor ) {
+   other.storage = nullptr;
+   other.storageSize = 0;
 }
 
-template <typename T, typename Sum>
-MedianFilter<T, Sum>& MedianFilter<T, Sum>::operator=(MedianFilter<T, Sum>&& other) {
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianFilter<T, Sum, Index, Allocator>& MedianFilter<T, Sum, Index, Allocator>::operator=(MedianFilter<T, Sum, Index, Allocator>&& other) {
+   if(this == &other) return *this;
+
+   if(!(allocator == other.allocator)) return *this = other;   // the block cannot change hands, copy into our own
+
+   release();
+   storage = other.storage;
+   storageSize = other.storageSize;
    medFilterWin = other.medFilterWin;
    medDataPointer = other.medDataPointer;
    oldestDataPoint = other.oldestDataPoint;
    totalSum = other.totalSum;
-   free(data);
-   free(sizeMap);
-   free(locationMap);
+   runningVariance = other.runningVariance;
+   engine = other.engine;
    data = other.data;
    sizeMap = other.sizeMap;
    locationMap = other.locationMap;
-   other.data = nullptr;
-   other.sizeMap = nullptr;
-   other.locationMap = nullptr;
+   records = other.records;
+   tree = other.tree;
+   histogram = other.histogram;
+   medianCursor = other.medianCursor;
+   other.storage = nullptr;
+   other.storageSize = 0;
    return *this;
 }
 
-template <typename T, typename Sum>
-MedianFilter<T, Sum>::~MedianFilter()
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianFilter<T, Sum, Index, Allocator>::~MedianFilter()
 {
   // Free up the used memory when the object is destroyed
-  free(data);
-  free(sizeMap);
-  free(locationMap);
+  release();
 }
 
-template <typename T, typename Sum>
-bool MedianFilter<T, Sum>::is_valid_value(T v)
+namespace median_filter_detail
 {
-   return true;
+   inline size_t align_up(size_t offset, size_t alignment)
+   {
+      return (offset + alignment - 1) / alignment * alignment;
+   }
 }
 
-template <>
-bool MedianFilter<float, double>::is_valid_value(float v)
+template <typename T, typename Sum, typename Index, typename Allocator>
+size_t MedianFilter<T, Sum, Index, Allocator>::storageNeeded() const
 {
-   return !std::isnan(v);
+   // data first, then the Index arrays; the block is aligned for both
+   const size_t maps = median_filter_detail::align_up(medFilterWin * sizeof(T), alignof(Index));
+
+   size_t bytes = maps + 2 * (size_t) medFilterWin * sizeof(Index);
+   if(engine == MedianFilterEngine::Tree)      bytes = maps + 4 * (size_t) medFilterWin * sizeof(Index);
+   if(engine == MedianFilterEngine::Histogram) bytes = maps + (histogram.bins + histogram.blocks) * sizeof(Index);
+   if(engine == MedianFilterEngine::Network)   bytes = medFilterWin * sizeof(T);   // the ring buffer alone
+   if(engine == MedianFilterEngine::Interleaved)   // location map, then the records on a cache line of their own
+   {
+      bytes = maps + medFilterWin * sizeof(Index) + MEDIAN_FILTER_CACHE_LINE - 1 + medFilterWin * sizeof(median_filter_detail::SortedRecord<T, Index>);
+   }
+
+   return (bytes + sizeof(Unit) - 1) / sizeof(Unit);
 }
 
-template <>
-bool MedianFilter<double, double>::is_valid_value(double v)
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::allocate()
 {
-   return !std::isnan(v);
+   const size_t needed = storageNeeded();
+   if(needed > storageSize)
+   {
+      release();
+      storage = UnitTraits::allocate(allocator, needed);
+      storageSize = needed;
+   }
+
+   Index * maps = (Index*) ((unsigned char*) storage + median_filter_detail::align_up(medFilterWin * sizeof(T), alignof(Index)));
+
+   data            = (T*) storage;   // array for data
+   sizeMap         = nullptr;
+   locationMap     = nullptr;
+   records         = nullptr;
+   tree.links      = nullptr;
+   tree.capacity   = medFilterWin;
+   tree.root       = tree.nil;
+   histogram.counts = nullptr;
+
+   if(engine == MedianFilterEngine::Tree)
+   {
+      tree.links   = maps;   // left, right, parent and subtree size of every slot
+   }
+   else if(engine == MedianFilterEngine::Histogram)
+   {
+      histogram.counts = maps;   // fine and coarse counters
+   }
+   else if(engine == MedianFilterEngine::Network)
+   {
+      // no maps
+   }
+   else if(engine == MedianFilterEngine::Interleaved)
+   {
+      locationMap  = maps;   // rank of every slot in the records
+      const uintptr_t end = (uintptr_t) (maps + medFilterWin);
+      records      = (median_filter_detail::SortedRecord<T, Index>*) ((end + MEDIAN_FILTER_CACHE_LINE - 1) / MEDIAN_FILTER_CACHE_LINE * MEDIAN_FILTER_CACHE_LINE);
+   }
+   else
+   {
+      sizeMap      = maps;                  // array for locations of data in sorted list
+      locationMap  = maps + medFilterWin;   // array for locations of history data in map list
+   }
 }
 
-template <>
-bool MedianFilter<float, float>::is_valid_value(float v)
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::release()
 {
-   return !std::isnan(v);
+   if(storage) UnitTraits::deallocate(allocator, storage, storageSize);
+   storage = nullptr;
+   storageSize = 0;
 }
 
-template <>
-bool MedianFilter<double, float>::is_valid_value(double v)
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::copyFrom(const MedianFilter<T, Sum, Index, Allocator> &other)
 {
-   return !std::isnan(v);
+   oldestDataPoint = other.oldestDataPoint;
+   totalSum = other.totalSum;
+   runningVariance = other.runningVariance;
+   tree.root = other.tree.root;
+   medianCursor = other.medianCursor;
+   memcpy(data, other.data, medFilterWin * sizeof(T));
+
+   if(engine == MedianFilterEngine::Tree)
+   {
+      memcpy(tree.links, other.tree.links, 4 * (size_t) medFilterWin * sizeof(Index));
+   }
+   else if(engine == MedianFilterEngine::Histogram)
+   {
+      memcpy(histogram.counts, other.histogram.counts, (histogram.bins + histogram.blocks) * sizeof(Index));
+   }
+   else if(engine == MedianFilterEngine::Network)
+   {
+      // the ring buffer is all there is
+   }
+   else if(engine == MedianFilterEngine::Interleaved)
+   {
+      memcpy(locationMap, other.locationMap, medFilterWin * sizeof(Index));
+      memcpy(records, other.records, medFilterWin * sizeof(median_filter_detail::SortedRecord<T, Index>));
+   }
+   else
+   {
+      memcpy(sizeMap, other.sizeMap, medFilterWin * sizeof(Index));
+      memcpy(locationMap, other.locationMap, medFilterWin * sizeof(Index));
+   }
 }
 
-template <typename T, typename Sum>
-T MedianFilter<T, Sum>::in(const T & value)
+namespace median_filter_detail
 {
-   // sort sizeMap
-   // small vaues on the left (-)
-   // larger values on the right (+)
+   template <typename T>
+   constexpr bool is_valid_value(const T &)
+   {
+      return true;
+   }
 
-   bool dataMoved = false;
-   const uint8_t rightEdge = medFilterWin - 1;  // adjusted for zero indexed array
+   inline bool is_valid_value(float v)
+   {
+      return !is_nan(v);
+   }
 
-   if (is_valid_value(value)) {
-      totalSum += ((Sum) value) - data[oldestDataPoint];  // add new value and remove oldest value
+   inline bool is_valid_value(double v)
+   {
+      return !is_nan(v);
+   }
+
+   // strict total order used for sorting, NaN sorts above every number
+   template <typename T>
+   inline bool ordered_less(const T & a, const T & b)
+   {
+      return a < b;
+   }
+
+   // for floating point -0 sorts below +0, so samples that tie are bit identical
+   inline bool ordered_less(float a, float b)
+   {
+      if(is_nan(b)) return !is_nan(a);
+      if(a == b) return sign_bit(a) && !sign_bit(b);
+      return a < b;
+   }
+
+   inline bool ordered_less(double a, double b)
+   {
+      if(is_nan(b)) return !is_nan(a);
+      if(a == b) return sign_bit(a) && !sign_bit(b);
+      return a < b;
    }
+}
 
-   data[oldestDataPoint] = value;  // store new data in location of oldest data in ring buffer
+namespace median_filter_detail
+{
+   template <typename T>
+   MEDIAN_FILTER_CONSTEXPR void RunningVariance::reset(const T & seed, size_t n)
+   {
+      mean = is_valid_value(seed) ? (double) seed : 0.0;
+      m2 = 0.0;
+      invalid = is_valid_value(seed) ? 0 : n;
+      sinceResync = 0;
+   }
 
-   // SORT LEFT (-) <======(n) (+)
-   if(locationMap[oldestDataPoint] > 0) // don't check left neighbours if at the extreme left
+   template <typename T>
+   void RunningVariance::update(const T & old, const T & value, const T * data, size_t n)   // data already holds value
    {
-      for(uint8_t i = locationMap[oldestDataPoint]; i > 0; i--)   //index through left adjacent data
+      const bool oldValid = is_valid_value(old);
+      const bool newValid = is_valid_value(value);
+
+      if(!oldValid) invalid--;
+      if(!newValid) invalid++;
+      if(invalid > 0) return;   // NaN in the window, nothing to track until it leaves
+
+      if(!oldValid || (resyncInterval != 0 && ++sinceResync >= resyncInterval))
       {
-         uint8_t n = i - 1;   // neighbour location
+         resum(data, n);   // the last NaN just left, or it is time to cancel drift
+         return;
+      }
 
-         if(data[oldestDataPoint] < data[sizeMap[n]]) // find insertion point, move old data into position
-         {
-            sizeMap[i] = sizeMap[n];   // move existing data right so the new data can go left
-            locationMap[sizeMap[n]]++;
+      const double delta = (double) value - (double) old;
+      const double oldMean = mean;
+      mean += delta / n;
+      m2 += delta * (((double) value - mean) + ((double) old - oldMean));
+   }
+
+   template <typename T>
+   void RunningVariance::resum(const T * data, size_t n)   // exact two pass recomputation, O(n)
+   {
+      double sum = 0.0;
+      for(size_t i = 0; i < n; i++) sum += (double) data[i];
+      mean = sum / n;
+
+      m2 = 0.0;
+      for(size_t i = 0; i < n; i++)
+      {
+         const double diff = (double) data[i] - mean;
+         m2 += diff * diff;
+      }
+      sinceResync = 0;
+   }
 
-            sizeMap[n] = oldestDataPoint; // assign new data to neighbor position
-            locationMap[oldestDataPoint]--;
+   inline QuantilePosition::QuantilePosition(double p, size_t n)
+   {
+      if(!(p > 0.0)) p = 0.0;   // also catches NaN
+      if(p > 1.0)    p = 1.0;
+
+      const double position = p * (n - 1);
+      rank = (size_t) position;
+      if(rank >= n - 1) rank = n - 1;
+      fraction = position - rank;
+   }
+
+   template <typename Sum, typename T>
+   inline Sum interpolate(const T & lower, const T & upper, double fraction)
+   {
+      if(fraction == 0.0) return (Sum) lower;
+      return (Sum) ((double) lower + fraction * ((double) upper - (double) lower));
+   }
+
+   // The distances from the median m = s[mid] of a sorted window s form two sorted runs, m - s[mid - 1 - i] going left and
+   // s[mid + j] - m going right.  The MAD is the element of rank mid in their merge, found by binary searching how many of
+   // the first mid + 1 distances come from the left run.  O(log n) calls of rank(i), the i-th smallest sample.
+   template <typename Sum, typename Rank>
+   Sum median_absolute_deviation(const Rank & rank, size_t n)
+   {
+      const size_t mid = n >> 1;
+      const Sum median = (Sum) rank(mid);
+
+      const size_t take = mid + 1;   // distances up to and including the MAD
+      size_t lo = (take > n - mid) ? take - (n - mid) : 0;   // an even window has one distance too few on the right
+      size_t hi = mid;                                       // the left run holds mid distances
 
-            dataMoved = true;
+      for(;;)
+      {
+         const size_t a = lo + ((hi - lo) >> 1);   // distances from the left run
+         const size_t b = take - a;                 // distances from the right run, at least 1
+
+         if(a < hi && (Sum) rank(mid + b - 1) - median > median - (Sum) rank(mid - 1 - a))
+         {
+            lo = a + 1;    // the last right distance taken is larger than the next left one, take more from the left
+         }
+         else if(a > lo && median - (Sum) rank(mid - a) > (Sum) rank(mid + b) - median)
+         {
+            hi = a - 1;    // the last left distance taken is larger than the next right one, take fewer from the left
          }
          else
          {
-            break; // stop checking once a smaller value is found on the left
+            const Sum right = (Sum) rank(mid + b - 1) - median;
+            if(a == 0) return right;
+
+            const Sum left = median - (Sum) rank(mid - a);
+            return (left > right) ? left : right;
          }
       }
    }
 
-   // SORT RIGHT (-) (n)======> (+)
-   if(!dataMoved && locationMap[oldestDataPoint] < rightEdge) // don't check right if at right border, or the data has already moved
+   inline double RunningVariance::variance(size_t n) const
    {
-      for(int i = locationMap[oldestDataPoint]; i < rightEdge; i++)   //index through left adjacent data
+      if(invalid > 0) return NAN;
+      return (m2 > 0.0) ? m2 / (n - 1.0) : 0.0;   // rounding can leave m2 slightly negative for a constant window
+   }
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+bool MedianFilter<T, Sum, Index, Allocator>::is_valid_value(T v)
+{
+   return median_filter_detail::is_valid_value(v);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T MedianFilter<T, Sum, Index, Allocator>::in(const T & value)
+{
+   const T old = data[oldestDataPoint];
+
+   if (is_valid_value(value)) {
+      totalSum += ((Sum) value) - old;  // add new value and remove oldest value
+   }
+
+   if(engine == MedianFilterEngine::Tree)
+   {
+      tree.erase(oldestDataPoint);        // unlink the oldest sample while its old value still orders the tree
+      data[oldestDataPoint] = value;
+      tree.insert(data, oldestDataPoint);
+   }
+   else if(engine == MedianFilterEngine::Histogram)
+   {
+      histogram.erase(old, medianCursor);
+      data[oldestDataPoint] = value;
+      histogram.insert(value, medianCursor);
+      histogram.seek(medianCursor, medDataPointer);
+   }
+   else if(engine == MedianFilterEngine::Interleaved)
+   {
+      data[oldestDataPoint] = value;
+      median_filter_detail::interleaved_update(records, locationMap, medFilterWin, oldestDataPoint, value);
+   }
+   else if(engine == MedianFilterEngine::Network)
+   {
+      data[oldestDataPoint] = value;   // out() runs the network over the ring buffer
+   }
+   else
+   {
+      data[oldestDataPoint] = value;  // store new data in location of oldest data in ring buffer
+      sortedUpdate(oldestDataPoint);
+   }
+
+   runningVariance.update(old, value, data, medFilterWin);
+
+   oldestDataPoint++;       // increment and wrap
+   if(oldestDataPoint == medFilterWin) oldestDataPoint = 0;
+
+   return out();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::in(const T * src, T * dst, size_t n)
+{
+   // one validity scan for the whole buffer lets clean buffers run without the per sample check
+   bool allValid = true;
+   for(size_t i = 0; i < n; i++)
+   {
+      allValid &= is_valid_value(src[i]);
+   }
+
+   if(allValid) inBlock<false>(src, dst, n);
+   else         inBlock<true>(src, dst, n);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+template <bool CheckValid>
+void MedianFilter<T, Sum, Index, Allocator>::inBlock(const T * src, T * dst, size_t n)
+{
+   // same steps as in(), with the ring position and running sum kept in locals for the whole block
+   Index oldest = oldestDataPoint;
+   Sum sum = totalSum;
+
+   if(engine == MedianFilterEngine::Tree)
+   {
+      for(size_t i = 0; i < n; i++)
       {
-         int n = i + 1;   // neighbour location
+         const T value = src[i];
+         const T old = data[oldest];
+         if(!CheckValid || is_valid_value(value)) sum += ((Sum) value) - old;
 
-         if(data[oldestDataPoint] > data[sizeMap[n]]) // find insertion point, move old data into position
-         {
-            sizeMap[i] = sizeMap[n];   // move existing data left so the new data can go right
-            locationMap[sizeMap[n]]--;
+         tree.erase(oldest);
+         data[oldest] = value;
+         tree.insert(data, oldest);
+         runningVariance.update(old, value, data, medFilterWin);
+
+         if(++oldest == medFilterWin) oldest = 0;
+         dst[i] = data[tree.select(medDataPointer)];
+      }
+   }
+   else if(engine == MedianFilterEngine::Histogram)
+   {
+      for(size_t i = 0; i < n; i++)
+      {
+         const T value = src[i];
+         const T old = data[oldest];
+         if(!CheckValid || is_valid_value(value)) sum += ((Sum) value) - old;
+
+         histogram.erase(old, medianCursor);
+         data[oldest] = value;
+         histogram.insert(value, medianCursor);
+         histogram.seek(medianCursor, medDataPointer);
+         runningVariance.update(old, value, data, medFilterWin);
+
+         if(++oldest == medFilterWin) oldest = 0;
+         dst[i] = histogram.value(medianCursor.bin);
+      }
+   }
+   else if(engine == MedianFilterEngine::Interleaved)
+   {
+      for(size_t i = 0; i < n; i++)
+      {
+         const T value = src[i];
+         const T old = data[oldest];
+         if(!CheckValid || is_valid_value(value)) sum += ((Sum) value) - old;
+
+         data[oldest] = value;
+         median_filter_detail::interleaved_update(records, locationMap, medFilterWin, oldest, value);
+         runningVariance.update(old, value, data, medFilterWin);
+
+         if(++oldest == medFilterWin) oldest = 0;
+         dst[i] = records[medDataPointer].value;
+      }
+   }
+   else if(engine == MedianFilterEngine::Network)
+   {
+      for(size_t i = 0; i < n; i++)
+      {
+         const T value = src[i];
+         const T old = data[oldest];
+         if(!CheckValid || is_valid_value(value)) sum += ((Sum) value) - old;
+
+         data[oldest] = value;
+         runningVariance.update(old, value, data, medFilterWin);
+
+         if(++oldest == medFilterWin) oldest = 0;
+         dst[i] = median_filter_detail::network_median(data, medFilterWin, 1);
+      }
+   }
+   else
+   {
+      for(size_t i = 0; i < n; i++)
+      {
+         const T value = src[i];
+         const T old = data[oldest];
+         if(!CheckValid || is_valid_value(value)) sum += ((Sum) value) - old;
+
+         data[oldest] = value;
+         sortedUpdate(oldest);
+         runningVariance.update(old, value, data, medFilterWin);
+
+         if(++oldest == medFilterWin) oldest = 0;
+         dst[i] = data[sizeMap[medDataPointer]];
+      }
+   }
+
+   oldestDataPoint = oldest;
+   totalSum = sum;
+}
+
+namespace median_filter_detail
+{
+   // move the sample in slot to its place in sizeMap, shared by every filter built on the sorted map.  Entry i of data, sizeMap
+   // and locationMap is stored at [i * stride], so MedianFilterBank sorts one channel of its interleaved arrays in place.
+   template <typename T, typename Index>
+   inline void sorted_update(const T * data, Index * sizeMap, Index * locationMap, Index medFilterWin, Index slot, size_t stride = 1)
+   {
+      // sort sizeMap
+      // small vaues on the left (-)
+      // larger values on the right (+)
+
+      const T value = data[(size_t) slot * stride];
+      const Index rightEdge = medFilterWin - 1;  // adjusted for zero indexed array
 
-            sizeMap[n] = oldestDataPoint; // assign new data to neighbor position
-            locationMap[oldestDataPoint]++;
+      Index location = locationMap[(size_t) slot * stride];
+      bool dataMoved = false;
+
+      // SORT LEFT (-) <======(n) (+)
+      while(location > 0)   // don't check left neighbours if at the extreme left
+      {
+         const Index neighbour = sizeMap[(size_t) (location - 1) * stride];
+         if(!(value < data[(size_t) neighbour * stride])) break;   // stop checking once a smaller value is found on the left
+
+         sizeMap[(size_t) location * stride] = neighbour;   // move existing data right so the new data can go left
+         locationMap[(size_t) neighbour * stride]++;
+         location--;
+         dataMoved = true;
+      }
+
+      // SORT RIGHT (-) (n)======> (+)
+      while(!dataMoved && location < rightEdge)   // don't check right if at right border, or the data has already moved
+      {
+         const Index neighbour = sizeMap[(size_t) (location + 1) * stride];
+         if(!(value > data[(size_t) neighbour * stride])) break;   // stop checking once a larger value is found on the right
+
+         sizeMap[(size_t) location * stride] = neighbour;   // move existing data left so the new data can go right
+         locationMap[(size_t) neighbour * stride]--;
+         location++;
+      }
+
+      sizeMap[(size_t) location * stride] = slot;   // the new data goes into the gap left by the shifts
+      locationMap[(size_t) slot * stride] = location;
+   }
+}
+
+namespace median_filter_detail
+{
+   // sorted[0 .. n) = data[0 .. n) in ascending order, insertion sort for the few samples of a network window
+   template <typename T>
+   inline void sorted_copy(const T * data, size_t n, T * sorted)
+   {
+      for(size_t i = 0; i < n; i++)
+      {
+         size_t j = i;
+         for(; j > 0 && data[i] < sorted[j - 1]; j--) sorted[j] = sorted[j - 1];
+         sorted[j] = data[i];
+      }
+   }
+}
+
+namespace median_filter_detail
+{
+   // give slot the new value and move its record to its place, shifting the records in between by one
+   template <typename T, typename Index>
+   inline void interleaved_update(SortedRecord<T, Index> * records, Index * locationMap, Index medFilterWin, Index slot, const T & value)
+   {
+      Index i = locationMap[slot];
+
+      if(i > 0 && value < records[i - 1].value)
+      {
+         do   // shift larger records right
+         {
+            records[i] = records[i - 1];
+            locationMap[records[i].slot] = i;
+            i--;
          }
-         else
+         while(i > 0 && value < records[i - 1].value);
+      }
+      else
+      {
+         const Index rightEdge = medFilterWin - 1;
+         while(i < rightEdge && records[i + 1].value < value)   // shift smaller records left
          {
-            break; // stop checking once a smaller value is found on the right
+            records[i] = records[i + 1];
+            locationMap[records[i].slot] = i;
+            i++;
          }
       }
+
+      records[i].value = value;
+      records[i].slot = slot;
+      locationMap[slot] = i;
    }
-   oldestDataPoint++;       // increment and wrap
-   if(oldestDataPoint == medFilterWin) oldestDataPoint = 0;
+}
 
-   return data[sizeMap[medDataPointer]];
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::sortedUpdate(Index slot)
+{
+   median_filter_detail::sorted_update(data, sizeMap, locationMap, medFilterWin, slot);
 }
 
-template <typename T, typename Sum>
-T MedianFilter<T, Sum>::out() const // return the value of the median data sample
+template <typename T, typename Sum, typename Index, typename Allocator>
+T MedianFilter<T, Sum, Index, Allocator>::out() const // return the value of the median data sample
 {
+   if(engine == MedianFilterEngine::Tree) return data[tree.select(medDataPointer)];
+   if(engine == MedianFilterEngine::Histogram) return histogram.value(medianCursor.bin);
+   if(engine == MedianFilterEngine::Interleaved) return records[medDataPointer].value;
+   if(engine == MedianFilterEngine::Network) return median_filter_detail::network_median(data, medFilterWin, 1);
+
    return  data[sizeMap[medDataPointer]];
 }
 
-template <typename T, typename Sum>
-T MedianFilter<T, Sum>::getMin() const
+template <typename T, typename Sum, typename Index, typename Allocator>
+T MedianFilter<T, Sum, Index, Allocator>::getMin() const
 {
+   if(engine == MedianFilterEngine::Tree) return data[tree.first()];
+   if(engine == MedianFilterEngine::Histogram) return getRank(0);
+   if(engine == MedianFilterEngine::Interleaved) return records[0].value;
+   if(engine == MedianFilterEngine::Network)
+   {
+      T smallest = data[0];
+      for(Index i = 1; i < medFilterWin; i++) smallest = median_filter_detail::network_min(smallest, data[i]);
+      return smallest;
+   }
+
    return data[sizeMap[ 0 ]];
 }
 
-template <typename T, typename Sum>
-T MedianFilter<T, Sum>::getMax() const
+template <typename T, typename Sum, typename Index, typename Allocator>
+T MedianFilter<T, Sum, Index, Allocator>::getMax() const
 {
+   if(engine == MedianFilterEngine::Tree) return data[tree.last()];
+   if(engine == MedianFilterEngine::Histogram) return getRank(medFilterWin - 1);
+   if(engine == MedianFilterEngine::Interleaved) return records[medFilterWin - 1].value;
+   if(engine == MedianFilterEngine::Network)
+   {
+      T largest = data[0];
+      for(Index i = 1; i < medFilterWin; i++) largest = median_filter_detail::network_max(largest, data[i]);
+      return largest;
+   }
+
    return data[sizeMap[ medFilterWin - 1 ]];
 }
 
-template <typename T, typename Sum>
-Sum MedianFilter<T, Sum>::getMean() const
+template <typename T, typename Sum, typename Index, typename Allocator>
+Sum MedianFilter<T, Sum, Index, Allocator>::getMean() const
 {
-   return totalSum / medFilterWin;
+   return totalSum / (Sum) medFilterWin;
 }
 
-template <typename T, typename Sum>
-Sum MedianFilter<T, Sum>::getStdDev() const // Arduino run time [us]: filterSize * 2 + 131
+template <typename T, typename Sum, typename Index, typename Allocator>
+Sum MedianFilter<T, Sum, Index, Allocator>::getStdDev() const // O(1), the variance is maintained by in()
 {
-   Sum diffSquareSum = 0;
-   Sum mean = getMean();
+   return Sum( median_filter_detail::square_root( runningVariance.variance(medFilterWin) + 0.5 ) );
+}
 
-   for( int i = 0; i < medFilterWin; i++ )
+template <typename T, typename Sum, typename Index, typename Allocator>
+Sum MedianFilter<T, Sum, Index, Allocator>::getMAD() const
+{
+   if(engine == MedianFilterEngine::Tree)
    {
-      Sum diff = data[i] - mean;
-      diffSquareSum += diff * diff;
+      return median_filter_detail::median_absolute_deviation<Sum>([this](size_t k) { return data[tree.select((Index) k)]; }, medFilterWin);
+   }
+   if(engine == MedianFilterEngine::Histogram)
+   {
+      median_filter_detail::HistogramCursor cursor = medianCursor;   // the ranks read all lie close to the median
+      return median_filter_detail::median_absolute_deviation<Sum>([this, &cursor](size_t k) {
+         histogram.seek(cursor, k);
+         return histogram.value(cursor.bin);
+      }, medFilterWin);
+   }
+   if(engine == MedianFilterEngine::Interleaved)
+   {
+      return median_filter_detail::median_absolute_deviation<Sum>([this](size_t k) { return records[k].value; }, medFilterWin);
+   }
+   if(engine == MedianFilterEngine::Network)
+   {
+      T sorted[9];
+      median_filter_detail::sorted_copy(data, medFilterWin, sorted);
+      return median_filter_detail::median_absolute_deviation<Sum>([&sorted](size_t k) { return sorted[k]; }, medFilterWin);
    }
 
-   return Sum( std::sqrt( ((double)(diffSquareSum / (medFilterWin - 1.0))) + 0.5 ) );
+   return median_filter_detail::median_absolute_deviation<Sum>([this](size_t k) { return data[sizeMap[k]]; }, medFilterWin);
 }
 
-template <typename T, typename Sum>
-void MedianFilter<T, Sum>::reset(T seed)
+template <typename T, typename Sum, typename Index, typename Allocator>
+T MedianFilter<T, Sum, Index, Allocator>::getRank(size_t k) const
+{
+   if(k >= medFilterWin) k = medFilterWin - 1;
+
+   if(engine == MedianFilterEngine::Tree) return data[tree.select((Index) k)];
+   if(engine == MedianFilterEngine::Histogram)
+   {
+      median_filter_detail::HistogramCursor cursor = medianCursor;
+      histogram.seek(cursor, k);
+      return histogram.value(cursor.bin);
+   }
+   if(engine == MedianFilterEngine::Interleaved) return records[k].value;
+   if(engine == MedianFilterEngine::Network)
+   {
+      T sorted[9];
+      median_filter_detail::sorted_copy(data, medFilterWin, sorted);
+      return sorted[k];
+   }
+
+   return data[sizeMap[k]];
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+Sum MedianFilter<T, Sum, Index, Allocator>::getQuantile(double p) const
+{
+   const median_filter_detail::QuantilePosition q(p, medFilterWin);
+
+   if(q.fraction == 0.0) return (Sum) getRank(q.rank);
+   return median_filter_detail::interpolate<Sum>(getRank(q.rank), getRank(q.rank + 1), q.fraction);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::getQuantiles(const double * p, Sum * quantiles, size_t count) const
+{
+   for(size_t i = 0; i < count; i++)
+   {
+      quantiles[i] = getQuantile(p[i]);
+   }
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::reset(T seed)
 {
    oldestDataPoint = medDataPointer;      // oldest data point location in data array
    totalSum        = medFilterWin * ((Sum) seed);         // total of all values
+   runningVariance.reset(seed, medFilterWin);
+
+   for(Index i = 0; i < medFilterWin; i++) // initialize the arrays
+   {
+      data[i]        = seed;   // populate with seed value
+   }
+
+   if(engine == MedianFilterEngine::Tree)
+   {
+      tree.clear();
+      for(Index i = 0; i < medFilterWin; i++)
+      {
+         tree.insert(data, i);
+      }
+      return;
+   }
+
+   if(engine == MedianFilterEngine::Histogram)
+   {
+      histogram.clear();
+      const size_t k = histogram.key(seed);
+      histogram.counts[k] = medFilterWin;
+      histogram.counts[histogram.bins + (k >> histogram.blockBits)] = medFilterWin;
+      medianCursor = median_filter_detail::HistogramCursor { k, 0 };
+      return;
+   }
+
+   if(engine == MedianFilterEngine::Network) return;
+
+   if(engine == MedianFilterEngine::Interleaved)
+   {
+      for(Index i = 0; i < medFilterWin; i++)
+      {
+         records[i].value = seed;
+         records[i].slot  = i;
+         locationMap[i]   = i;
+      }
+      return;
+   }
 
-   for(uint8_t i = 0; i < medFilterWin; i++) // initialize the arrays
+   for(Index i = 0; i < medFilterWin; i++)
    {
       sizeMap[i]     = i;      // start map with straight run
       locationMap[i] = i;      // start map with straight run
-      data[i]        = seed;   // populate with seed value
    }
 }
 
+template <typename T, typename Sum, typename Index, typename Allocator>
+typename MedianFilter<T, Sum, Index, Allocator>::template View<typename MedianFilter<T, Sum, Index, Allocator>::SortedIterator> MedianFilter<T, Sum, Index, Allocator>::sorted() const
+{
+   const Index first = (engine == MedianFilterEngine::Tree) ? tree.first() : 0;
+
+   return View<SortedIterator>(SortedIterator(this, 0, first), SortedIterator(this, medFilterWin, tree.nil), medFilterWin);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+typename MedianFilter<T, Sum, Index, Allocator>::template View<typename MedianFilter<T, Sum, Index, Allocator>::AgeIterator> MedianFilter<T, Sum, Index, Allocator>::byAge() const
+{
+   return View<AgeIterator>(AgeIterator(this, 0), AgeIterator(this, medFilterWin), medFilterWin);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianFilterEngine MedianFilter<T, Sum, Index, Allocator>::getEngine() const
+{
+   return engine;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+typename MedianFilter<T, Sum, Index, Allocator>::allocator_type MedianFilter<T, Sum, Index, Allocator>::get_allocator() const
+{
+   return allocator_type(allocator);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void MedianFilter<T, Sum, Index, Allocator>::setStdDevResync(uint32_t updates)
+{
+   runningVariance.resyncInterval = updates;
+   runningVariance.sinceResync = 0;
+}
 
 // *** debug fuctions ***
 /*
@@ -0,0 +1,85 @@
+/*
+  MedianFilterBank.h - Bank of same sized median filters for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   A MedianFilterBank runs Channels independent median filters of the same window size that all receive one sample per tick.
+
+   It behaves like Channels MedianFilter<T, Sum, Index> objects, but the ring buffers and maps of all channels share three
+   allocations in structure of arrays layout: entry i of every channel is stored next to each other (data[i * Channels + channel]).
+   A tick writes one contiguous row of samples and every channel then sorts its new sample into its own map.
+
+   in() takes one sample per channel and writes the median of every channel.
+
+   Windows of 3, 5, 7 and 9 samples skip the maps altogether: the median of each channel is taken straight from the ring buffer
+   with a selection network, vectorised across channels with AVX2 / SSE4.1 where the CPU has it (see MedianFilterSimd.h).
+   Results match the map path for integer samples and for floating point samples without NaN.
+ */
+
+#ifndef MedianFilterBank_h
+
+   #define MedianFilterBank_h
+
+   #include "MedianFilter.h"
+   #include "MedianFilterSimd.h"
+
+   template <typename T, typename Sum, size_t Channels, typename Index = uint8_t>
+   class MedianFilterBank
+   {
+      static_assert(Channels > 0, "a bank needs at least one channel");
+      static_assert(median_filter_detail::limits<Index>::is_integer && !median_filter_detail::limits<Index>::is_signed, "Index must be an unsigned integer type");
+
+      public:
+         MedianFilterBank(size_t size, T seed);
+         MedianFilterBank(const MedianFilterBank<T, Sum, Channels, Index> &other);
+         MedianFilterBank(MedianFilterBank<T, Sum, Channels, Index> &&other);
+         ~MedianFilterBank();
+
+         void in(const T * values, T * medians);   // values and medians hold Channels entries, they may be the same array
+         void out(T * medians) const;
+         T out(size_t channel) const;
+
+         T getMin(size_t channel) const;
+         T getMax(size_t channel) const;
+         Sum getMean(size_t channel) const;
+
+         void reset(T seed);
+
+         size_t channels() const { return Channels; }
+
+         MedianFilterBank<T, Sum, Channels, Index>& operator=(const MedianFilterBank<T, Sum, Channels, Index>&);
+         MedianFilterBank<T, Sum, Channels, Index>& operator=(MedianFilterBank<T, Sum, Channels, Index>&&);
+
+      private:
+         Index medFilterWin;      // number of samples in every sliding window
+         Index medDataPointer;    // mid point of window
+         T * data;                // ring buffers, data[slot * Channels + channel]
+         Index * sizeMap;         // slots sorted by size, sizeMap[rank * Channels + channel]
+         Index * locationMap;     // rank of each slot, locationMap[slot * Channels + channel]
+         Index oldestDataPoint;   // oldest slot, shared since every channel gets a sample per tick
+         Sum totalSum[Channels];
+         bool network;            // window handled by the selection network, sizeMap and locationMap are not used
+
+         void allocate();
+         void release();
+         void copyFrom(const MedianFilterBank<T, Sum, Channels, Index> &other);
+         void sortChannel(size_t channel);
+   };
+
+#include "MedianFilterBank.hpp"
+
+#endif
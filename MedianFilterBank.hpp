@@ -0,0 +1,252 @@
+/*
+   MedianFilterBank.hpp - Bank of same sized median filters for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MedianFilterBank.h"
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+MedianFilterBank<T, Sum, Channels, Index>::MedianFilterBank(size_t size, T seed)
+{
+   medFilterWin    = median_filter_detail::clamp(size, (size_t) 3, (size_t) median_filter_detail::limits<Index>::highest());
+   medDataPointer  = medFilterWin >> 1;
+   network         = median_filter_detail::is_network_window(medFilterWin);
+
+   allocate();
+   reset(seed);
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+MedianFilterBank<T, Sum, Channels, Index>::MedianFilterBank(const MedianFilterBank<T, Sum, Channels, Index> &other) :
+   medFilterWin { other.medFilterWin },
+   medDataPointer { other.medDataPointer },
+   network { other.network } {
+   allocate();
+   copyFrom(other);
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+MedianFilterBank<T, Sum, Channels, Index>::MedianFilterBank(MedianFilterBank<T, Sum, Channels, Index> &&other) :
+   medFilterWin { other.medFilterWin },
+   medDataPointer { other.medDataPointer },
+   data { other.data },
+   sizeMap { other.sizeMap },
+   locationMap { other.locationMap },
+   oldestDataPoint { other.oldestDataPoint },
+   network { other.network } {
+   memcpy(totalSum, other.totalSum, sizeof(totalSum));
+   other.data = nullptr;
+   other.sizeMap = nullptr;
+   other.locationMap = nullptr;
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+MedianFilterBank<T, Sum, Channels, Index>& MedianFilterBank<T, Sum, Channels, Index>::operator=(const MedianFilterBank<T, Sum, Channels, Index>& other) {
+   if(this == &other) return *this;
+
+   release();
+   medFilterWin = other.medFilterWin;
+   medDataPointer = other.medDataPointer;
+   network = other.network;
+   allocate();
+   copyFrom(other);
+
+   return *this;
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+MedianFilterBank<T, Sum, Channels, Index>& MedianFilterBank<T, Sum, Channels, Index>::operator=(MedianFilterBank<T, Sum, Channels, Index>&& other) {
+   if(this == &other) return *this;
+
+   release();
+   medFilterWin = other.medFilterWin;
+   medDataPointer = other.medDataPointer;
+   oldestDataPoint = other.oldestDataPoint;
+   network = other.network;
+   memcpy(totalSum, other.totalSum, sizeof(totalSum));
+   data = other.data;
+   sizeMap = other.sizeMap;
+   locationMap = other.locationMap;
+   other.data = nullptr;
+   other.sizeMap = nullptr;
+   other.locationMap = nullptr;
+   return *this;
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+MedianFilterBank<T, Sum, Channels, Index>::~MedianFilterBank()
+{
+   release();
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+void MedianFilterBank<T, Sum, Channels, Index>::allocate()
+{
+   const size_t entries = (size_t) medFilterWin * Channels;
+
+   data        = (T*) calloc (entries, sizeof(T));
+   sizeMap     = nullptr;
+   locationMap = nullptr;
+
+   if(!network)
+   {
+      sizeMap     = (Index*) calloc (entries, sizeof(Index));
+      locationMap = (Index*) calloc (entries, sizeof(Index));
+   }
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+void MedianFilterBank<T, Sum, Channels, Index>::release()
+{
+   free(data);
+   free(sizeMap);
+   free(locationMap);
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+void MedianFilterBank<T, Sum, Channels, Index>::copyFrom(const MedianFilterBank<T, Sum, Channels, Index> &other)
+{
+   const size_t entries = (size_t) medFilterWin * Channels;
+
+   oldestDataPoint = other.oldestDataPoint;
+   memcpy(totalSum, other.totalSum, sizeof(totalSum));
+   memcpy(data, other.data, entries * sizeof(T));
+
+   if(!network)
+   {
+      memcpy(sizeMap, other.sizeMap, entries * sizeof(Index));
+      memcpy(locationMap, other.locationMap, entries * sizeof(Index));
+   }
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+void MedianFilterBank<T, Sum, Channels, Index>::in(const T * values, T * medians)
+{
+   T * row = data + (size_t) oldestDataPoint * Channels;   // oldest sample of every channel
+
+   for(size_t c = 0; c < Channels; c++)
+   {
+      const T value = values[c];
+      if(median_filter_detail::is_valid_value(value)) {
+         totalSum[c] += ((Sum) value) - row[c];  // add new value and remove oldest value
+      }
+      row[c] = value;
+   }
+
+   if(!network)
+   {
+      for(size_t c = 0; c < Channels; c++)
+      {
+         sortChannel(c);
+      }
+   }
+
+   oldestDataPoint++;       // increment and wrap
+   if(oldestDataPoint == medFilterWin) oldestDataPoint = 0;
+
+   out(medians);
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+void MedianFilterBank<T, Sum, Channels, Index>::sortChannel(size_t c)
+{
+   // this channel's entries sit Channels apart, the same insertion step as MedianFilter with a stride
+   median_filter_detail::sorted_update(data + c, sizeMap + c, locationMap + c, medFilterWin, oldestDataPoint, Channels);
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+void MedianFilterBank<T, Sum, Channels, Index>::out(T * medians) const
+{
+   if(network)
+   {
+      median_filter_detail::network_medians(data, medFilterWin, Channels, medians);
+      return;
+   }
+
+   const Index * middle = sizeMap + (size_t) medDataPointer * Channels;   // median slot of every channel
+
+   for(size_t c = 0; c < Channels; c++)
+   {
+      medians[c] = data[(size_t) middle[c] * Channels + c];
+   }
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+T MedianFilterBank<T, Sum, Channels, Index>::out(size_t channel) const
+{
+   if(network) return median_filter_detail::network_median(data + channel, medFilterWin, Channels);
+
+   return data[(size_t) sizeMap[(size_t) medDataPointer * Channels + channel] * Channels + channel];
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+T MedianFilterBank<T, Sum, Channels, Index>::getMin(size_t channel) const
+{
+   if(network)
+   {
+      T smallest = data[channel];
+      for(Index i = 1; i < medFilterWin; i++) smallest = median_filter_detail::network_min(smallest, data[(size_t) i * Channels + channel]);
+      return smallest;
+   }
+
+   return data[(size_t) sizeMap[channel] * Channels + channel];
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+T MedianFilterBank<T, Sum, Channels, Index>::getMax(size_t channel) const
+{
+   if(network)
+   {
+      T largest = data[channel];
+      for(Index i = 1; i < medFilterWin; i++) largest = median_filter_detail::network_max(largest, data[(size_t) i * Channels + channel]);
+      return largest;
+   }
+
+   return data[(size_t) sizeMap[(size_t) (medFilterWin - 1) * Channels + channel] * Channels + channel];
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+Sum MedianFilterBank<T, Sum, Channels, Index>::getMean(size_t channel) const
+{
+   return totalSum[channel] / (Sum) medFilterWin;
+}
+
+template <typename T, typename Sum, size_t Channels, typename Index>
+void MedianFilterBank<T, Sum, Channels, Index>::reset(T seed)
+{
+   oldestDataPoint = medDataPointer;
+
+   for(size_t c = 0; c < Channels; c++)
+   {
+      totalSum[c] = medFilterWin * ((Sum) seed);
+   }
+
+   for(size_t i = 0; i < (size_t) medFilterWin * Channels; i++)
+   {
+      data[i] = seed;
+   }
+
+   if(network) return;
+
+   for(Index i = 0; i < medFilterWin; i++)
+   {
+      for(size_t c = 0; c < Channels; c++)
+      {
+         sizeMap[(size_t) i * Channels + c]     = i;      // start map with straight run
+         locationMap[(size_t) i * Channels + c] = i;
+      }
+   }
+}
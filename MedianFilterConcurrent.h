@@ -0,0 +1,92 @@
+/*
+  MedianFilterConcurrent.h - Single writer, many reader median filter for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   ConcurrentMedianFilter wraps a MedianFilter for one writer thread and any number of reader threads.
+
+   Only the writer calls in(), publish() and reset().  After every in(value), and once at the end of a buffer passed to
+   in(src, dst, n), the writer publishes a MedianSnapshot (median, min, max, mean and the number of samples taken so far)
+   through a sequence lock.  Readers copy the last published snapshot with snapshot() or the single value getters.
+
+   The writer never waits: publishing is two counter stores around five relaxed atomic stores.  A reader retries its copy
+   only when a publish overlapped it, so readers can not slow down the ingest path and never see a torn snapshot.  The
+   snapshot lives on its own cache line away from the filter state.
+
+   T and Sum must be lock free atomics on the target (true for the integer and floating point types on 64 bit hosts).
+   Requires a host platform with <atomic>, it is not included by MedianFilter.h.
+ */
+
+#ifndef MedianFilterConcurrent_h
+
+   #define MedianFilterConcurrent_h
+
+   #include "MedianFilter.h"
+
+   #include <atomic>
+
+   template <typename T, typename Sum>
+   struct MedianSnapshot
+   {
+      T median;
+      T min;
+      T max;
+      Sum mean;
+      uint64_t count;   // samples given to in() since construction or reset
+   };
+
+   template <typename T, typename Sum, typename Index = uint8_t, typename Allocator = median_filter_detail::CallocAllocator<unsigned char> >
+   class ConcurrentMedianFilter
+   {
+      public:
+         ConcurrentMedianFilter(size_t size, T seed, MedianFilterEngine engine = MedianFilterEngine::Auto, const Allocator & allocator = Allocator());
+
+         // writer thread only
+         T in(const T & value);                       // filters and publishes, returns the median
+         void in(const T * src, T * dst, size_t n);   // filters the buffer, publishes once at the end
+         void publish();
+         void reset(T seed);
+         const MedianFilter<T, Sum, Index, Allocator> & filter() const;
+
+         // any thread
+         MedianSnapshot<T, Sum> snapshot() const;
+         T out() const;
+         T getMin() const;
+         T getMax() const;
+         Sum getMean() const;
+         uint64_t count() const;
+
+      private:
+         MedianFilter<T, Sum, Index, Allocator> window;
+         uint64_t taken;   // samples since construction or reset, writer side
+
+         struct alignas(MEDIAN_FILTER_CACHE_LINE) Published
+         {
+            std::atomic<uint32_t> sequence;   // odd while the writer is storing
+            std::atomic<T> median;
+            std::atomic<T> min;
+            std::atomic<T> max;
+            std::atomic<Sum> mean;
+            std::atomic<uint64_t> count;
+         };
+
+         Published published;
+   };
+
+#include "MedianFilterConcurrent.hpp"
+
+#endif
@@ -0,0 +1,128 @@
+/*
+   MedianFilterConcurrent.hpp - Single writer, many reader median filter for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MedianFilterConcurrent.h"
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+ConcurrentMedianFilter<T, Sum, Index, Allocator>::ConcurrentMedianFilter(size_t size, T seed, MedianFilterEngine engine, const Allocator & allocator) :
+   window(size, seed, engine, allocator),
+   taken { 0 }
+{
+   published.sequence.store(0, std::memory_order_relaxed);
+   publish();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void ConcurrentMedianFilter<T, Sum, Index, Allocator>::publish()
+{
+   // sequence lock write side: odd count, fence, relaxed stores, even count with release
+   const uint32_t sequence = published.sequence.load(std::memory_order_relaxed);
+   published.sequence.store(sequence + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+
+   published.median.store(window.out(), std::memory_order_relaxed);
+   published.min.store(window.getMin(), std::memory_order_relaxed);
+   published.max.store(window.getMax(), std::memory_order_relaxed);
+   published.mean.store(window.getMean(), std::memory_order_relaxed);
+   published.count.store(taken, std::memory_order_relaxed);
+
+   published.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ConcurrentMedianFilter<T, Sum, Index, Allocator>::in(const T & value)
+{
+   const T median = window.in(value);
+   taken++;
+   publish();
+   return median;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void ConcurrentMedianFilter<T, Sum, Index, Allocator>::in(const T * src, T * dst, size_t n)
+{
+   window.in(src, dst, n);
+   taken += n;
+   publish();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void ConcurrentMedianFilter<T, Sum, Index, Allocator>::reset(T seed)
+{
+   window.reset(seed);
+   taken = 0;
+   publish();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+const MedianFilter<T, Sum, Index, Allocator> & ConcurrentMedianFilter<T, Sum, Index, Allocator>::filter() const
+{
+   return window;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+MedianSnapshot<T, Sum> ConcurrentMedianFilter<T, Sum, Index, Allocator>::snapshot() const
+{
+   MedianSnapshot<T, Sum> copy;
+
+   for(;;)
+   {
+      // sequence lock read side: retry while a publish is in progress or overlapped the copy
+      const uint32_t before = published.sequence.load(std::memory_order_acquire);
+      if(before & 1) continue;
+
+      copy.median = published.median.load(std::memory_order_relaxed);
+      copy.min    = published.min.load(std::memory_order_relaxed);
+      copy.max    = published.max.load(std::memory_order_relaxed);
+      copy.mean   = published.mean.load(std::memory_order_relaxed);
+      copy.count  = published.count.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(published.sequence.load(std::memory_order_relaxed) == before) return copy;
+   }
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ConcurrentMedianFilter<T, Sum, Index, Allocator>::out() const
+{
+   return published.median.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ConcurrentMedianFilter<T, Sum, Index, Allocator>::getMin() const
+{
+   return published.min.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ConcurrentMedianFilter<T, Sum, Index, Allocator>::getMax() const
+{
+   return published.max.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+Sum ConcurrentMedianFilter<T, Sum, Index, Allocator>::getMean() const
+{
+   return published.mean.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+uint64_t ConcurrentMedianFilter<T, Sum, Index, Allocator>::count() const
+{
+   return published.count.load(std::memory_order_acquire);
+}
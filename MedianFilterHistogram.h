@@ -0,0 +1,136 @@
+/*
+  MedianFilterHistogram.h - Counting histogram with a rank cursor, part of the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   CountingHistogram keeps one counter per possible value of an integer sample type of 16 bits or less, plus one coarse
+   counter per block of sqrt(bins) neighbouring values (16 blocks of 16 for 8 bit samples, 256 blocks of 256 for 16 bit ones).
+   The caller allocates the bins + blocks counters.
+
+   A HistogramCursor marks a bin together with the number of samples in the bins below it.  Inserting or erasing a sample
+   keeps a cursor's count correct in O(1), and seek() walks the cursor to the bin holding a given rank, stepping over whole
+   empty or passed blocks at once.  Between two samples the median moves by at most one rank, so a cursor parked on the
+   median moves a short distance per sample.
+
+   Used by the histogram engine of MedianFilter.
+ */
+
+#ifndef MedianFilterHistogram_h
+
+   #define MedianFilterHistogram_h
+
+   #include "MedianFilterPlatform.h"
+
+   namespace median_filter_detail
+   {
+      struct HistogramCursor
+      {
+         size_t bin;     // bin the cursor is on
+         size_t below;   // samples in the bins below it
+      };
+
+      template <typename T, typename Index>
+      struct CountingHistogram
+      {
+         // a 16 bit size_t (AVR) cannot count 2^16 bins, there the histogram takes 8 bit samples only
+         static const bool available = is_integral<T>::value && sizeof(T) <= 2 && sizeof(T) < sizeof(size_t) && !is_same<T, bool>::value;
+
+         static const size_t bits = available ? 8 * sizeof(T) : 8;   // wider types never use the histogram, keep the sizes valid
+         static const size_t blockBits = bits / 2;
+         static const size_t bins = (size_t) 1 << bits;
+         static const size_t blockSize = (size_t) 1 << blockBits;
+         static const size_t blocks = bins >> blockBits;
+
+         Index * counts;   // bins fine counters followed by blocks coarse counters
+
+         static size_t key(const T & v) { return (size_t) ((long) v - (long) limits<T>::lowest()); }
+         static T value(size_t bin) { return (T) ((long) bin + (long) limits<T>::lowest()); }
+
+         void clear();
+         void insert(const T & v, HistogramCursor & cursor);
+         void erase(const T & v, HistogramCursor & cursor);
+         void seek(HistogramCursor & cursor, size_t rank) const;
+      };
+
+      template <typename T, typename Index>
+      void CountingHistogram<T, Index>::clear()
+      {
+         for(size_t i = 0; i < bins + blocks; i++)
+         {
+            counts[i] = 0;
+         }
+      }
+
+      template <typename T, typename Index>
+      void CountingHistogram<T, Index>::insert(const T & v, HistogramCursor & cursor)
+      {
+         const size_t k = key(v);
+         counts[k]++;
+         counts[bins + (k >> blockBits)]++;
+         if(k < cursor.bin) cursor.below++;
+      }
+
+      template <typename T, typename Index>
+      void CountingHistogram<T, Index>::erase(const T & v, HistogramCursor & cursor)
+      {
+         const size_t k = key(v);
+         counts[k]--;
+         counts[bins + (k >> blockBits)]--;
+         if(k < cursor.bin) cursor.below--;
+      }
+
+      template <typename T, typename Index>
+      void CountingHistogram<T, Index>::seek(HistogramCursor & cursor, size_t rank) const   // rank must be below the sample count
+      {
+         const Index * fine = counts;
+         const Index * coarse = counts + bins;
+
+         while(cursor.below > rank)   // the rank lies in a lower bin
+         {
+            if((cursor.bin & (blockSize - 1)) == 0)
+            {
+               const size_t block = (cursor.bin >> blockBits) - 1;
+               if(cursor.below - coarse[block] > rank)   // ... below the whole previous block
+               {
+                  cursor.below -= coarse[block];
+                  cursor.bin -= blockSize;
+                  continue;
+               }
+            }
+            cursor.bin--;
+            cursor.below -= fine[cursor.bin];
+         }
+
+         while(cursor.below + fine[cursor.bin] <= rank)   // the rank lies in a higher bin
+         {
+            if((cursor.bin & (blockSize - 1)) == 0)
+            {
+               const size_t block = cursor.bin >> blockBits;
+               if(cursor.below + coarse[block] <= rank)   // ... above this whole block
+               {
+                  cursor.below += coarse[block];
+                  cursor.bin += blockSize;
+                  continue;
+               }
+            }
+            cursor.below += fine[cursor.bin];
+            cursor.bin++;
+         }
+      }
+   }
+
+#endif
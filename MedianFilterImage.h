@@ -0,0 +1,56 @@
+/*
+  MedianFilterImage.h - Constant time 2D median filter for 8 and 16 bit images, part of the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   median_filter_2d() filters a uint8_t or uint16_t image (rows of `width` pixels, no padding between rows) with a square
+   (2 * radius + 1)^2 kernel.  out[y * width + x] is the median of the kernel centred on in[y * width + x].  Pixels outside the
+   image are supplied by the edge mode as in median_filter(), applied to rows and columns independently; the default repeats the
+   nearest edge pixel.
+
+   The filter keeps one histogram per image column covering the 2 * radius + 1 rows of the kernel, and a kernel histogram that
+   slides along the row by adding the column entering on the right and removing the one leaving on the left (S. Perreault and
+   P. Hébert, "Median Filtering in Constant Time", 2007).  Histograms have two levels: coarse bins over the high bits, fine bins
+   over all of them.  The coarse level locates the median bin, then only that bin's fine counts are brought up to date and
+   scanned.  Per pixel cost is independent of the radius.  The add / subtract loops run over contiguous counters of fixed
+   length and are vectorised by the compiler.  Column histograms cost (tile width + 2 * radius) * 544 bytes per worker for
+   uint8_t, at most 36 MB at the largest radius.
+
+   A uint16_t column histogram is 128 kB, which would need (32 + 2 * radius) * 128 kB per worker.  16 bit images therefore
+   slide a single kernel histogram along each row instead (T. Huang's running histogram), adding and removing one column of
+   2 * radius + 1 pixels per step: O(radius) per pixel in about 260 kB per worker, and faster than the column histograms at
+   every radius measured.  Defining MEDIAN_FILTER_IMAGE16_RADIUS uses column histograms up to that radius.
+
+   The image is cut into tiles of whole columns by bands of rows; every tile primes its own column histograms from the
+   neighbouring pixels, so tiles are independent and are handed to `threads` worker threads (0 = all cores).  The radius is
+   limited to 32767.  Requires a host platform with std::thread, it is not included by MedianFilter.h.  `in` and `out` must
+   not overlap.
+ */
+
+#ifndef MedianFilterImage_h
+
+   #define MedianFilterImage_h
+
+   #include "MedianFilterOffline.h"
+
+   template <typename T>
+   void median_filter_2d(const T * in, T * out, size_t width, size_t height, size_t radius,
+                         MedianEdgeMode edge = MedianEdgeMode::Nearest, unsigned threads = 0);
+
+#include "MedianFilterImage.hpp"
+
+#endif
@@ -0,0 +1,353 @@
+/*
+   MedianFilterImage.hpp - Constant time 2D median filter for 8 and 16 bit images, part of the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MedianFilterImage.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifndef MEDIAN_FILTER_MIN_TILE
+   #define MEDIAN_FILTER_MIN_TILE 16384   // smallest tile worth a hand-off, in pixels
+#endif
+
+#ifndef MEDIAN_FILTER_IMAGE16_RADIUS
+   #define MEDIAN_FILTER_IMAGE16_RADIUS 0   // largest 16 bit radius with column histograms, (32 + 2 * radius) * 128 kB per worker
+#endif
+
+namespace median_filter_detail
+{
+   // histogram geometry per pixel type: coarse bins over the high bits, tile width bounding the column histogram memory
+   template <typename T>
+   struct image_histogram;
+
+   // and the largest radius served by column histograms, beyond it tiles slide a single kernel histogram instead
+   template <>
+   struct image_histogram<uint8_t>
+   {
+      static const size_t bits = 8;
+      static const size_t coarseBits = 4;
+      static const size_t tileColumns = 512;     // plus the halo, 544 bytes of column histogram per column
+      static const size_t columnRadius = 32767;  // at most 35 MB of column histograms per worker
+   };
+
+   template <>
+   struct image_histogram<uint16_t>
+   {
+      static const size_t bits = 16;
+      static const size_t coarseBits = 8;
+      static const size_t tileColumns = 32;      // plus the halo, 128 kB of column histogram per column
+      static const size_t columnRadius = MEDIAN_FILTER_IMAGE16_RADIUS;
+   };
+
+   const size_t slideColumns = 512;   // tile width when sliding a kernel histogram
+
+   // index of padded position q along an axis of n pixels, n stands for a zero pixel
+   inline size_t padded_index(ptrdiff_t q, size_t n, MedianEdgeMode edge)
+   {
+      if(q >= 0 && (size_t) q < n) return (size_t) q;
+
+      switch(edge)
+      {
+         case MedianEdgeMode::Nearest:
+            return (q < 0) ? 0 : n - 1;
+
+         case MedianEdgeMode::Reflect:
+         {
+            const size_t period = 2 * n;
+            const size_t p = (q >= 0) ? (size_t) q % period : (period - (size_t) (-q) % period) % period;
+            return (p < n) ? p : period - 1 - p;
+         }
+
+         default:
+            return n;
+      }
+   }
+
+   // column and kernel histograms for one tile of whole columns, reused by a worker for all the tiles it runs
+   template <typename T>
+   class ImageMedianTile
+   {
+      public:
+         static const size_t coarse = (size_t) 1 << image_histogram<T>::coarseBits;
+         static const size_t shift = image_histogram<T>::bits - image_histogram<T>::coarseBits;
+         static const size_t segment = (size_t) 1 << shift;   // fine bins per coarse bin
+         static const size_t fine = coarse * segment;
+
+         ImageMedianTile(const T * in, T * out, size_t width, size_t height, size_t radius, MedianEdgeMode edge) :
+            in { in }, out { out }, width { width }, height { height }, radius { radius }, edge { edge },
+            kernelCoarse(coarse), kernelFine(fine), synced(coarse) {}
+
+         void run(size_t x0, size_t x1, size_t y0, size_t y1);     // column histograms, O(1) per pixel
+         void slide(size_t x0, size_t x1, size_t y0, size_t y1);   // one kernel histogram, O(radius) per pixel
+
+      private:
+         const T * in;
+         T * out;
+         size_t width;
+         size_t height;
+         size_t radius;
+         MedianEdgeMode edge;
+
+         size_t columns;                        // tile columns plus the halo on both sides
+         std::vector<size_t> source;            // image column of every tile column, width for a zero column
+         std::vector<uint16_t> columnCoarse;    // columns x coarse counts over the kernel rows
+         std::vector<uint16_t> columnFine;      // columns x fine counts over the kernel rows
+         std::vector<uint32_t> kernelCoarse;
+         std::vector<uint32_t> kernelFine;      // per coarse bin segment, valid for the kernel at column synced[bin]
+         std::vector<ptrdiff_t> synced;
+
+         void prepare(size_t x0, size_t x1);
+         void addRow(ptrdiff_t y, int delta);
+         void syncSegment(size_t bin, ptrdiff_t i);
+         void addColumn(const size_t * rows, size_t c, int delta);
+   };
+
+   template <typename T>
+   void ImageMedianTile<T>::addRow(ptrdiff_t y, int delta)
+   {
+      const size_t row = padded_index(y, height, edge);
+      const T * pixels = in + row * width;
+
+      for(size_t c = 0; c < columns; c++)
+      {
+         const T v = (row == height || source[c] == width) ? T(0) : pixels[source[c]];
+         columnCoarse[c * coarse + (v >> shift)] += delta;
+         columnFine[c * fine + v] += delta;
+      }
+   }
+
+   template <typename T>
+   void ImageMedianTile<T>::syncSegment(size_t bin, ptrdiff_t i)
+   {
+      const ptrdiff_t span = 2 * (ptrdiff_t) radius + 1;
+      uint32_t * counts = &kernelFine[bin * segment];
+
+      if(i - synced[bin] >= (span + 1) / 2)   // rebuilding from the kernel's columns is cheaper than catching up
+      {
+         for(size_t j = 0; j < segment; j++) counts[j] = 0;
+
+         for(ptrdiff_t c = i; c < i + span; c++)
+         {
+            const uint16_t * add = &columnFine[c * fine + bin * segment];
+            for(size_t j = 0; j < segment; j++) counts[j] += add[j];
+         }
+      }
+      else
+      {
+         for(ptrdiff_t c = synced[bin] + 1; c <= i; c++)
+         {
+            const uint16_t * add = &columnFine[(c + span - 1) * fine + bin * segment];
+            const uint16_t * sub = &columnFine[(c - 1) * fine + bin * segment];
+            for(size_t j = 0; j < segment; j++) counts[j] += add[j] - sub[j];
+         }
+      }
+
+      synced[bin] = i;
+   }
+
+   template <typename T>
+   void ImageMedianTile<T>::prepare(size_t x0, size_t x1)
+   {
+      columns = (x1 - x0) + 2 * radius;
+      source.resize(columns);
+      for(size_t c = 0; c < columns; c++)
+      {
+         source[c] = padded_index((ptrdiff_t) (x0 + c) - (ptrdiff_t) radius, width, edge);
+      }
+   }
+
+   template <typename T>
+   void ImageMedianTile<T>::run(size_t x0, size_t x1, size_t y0, size_t y1)
+   {
+      const size_t span = 2 * radius + 1;
+      const uint32_t target = (uint32_t) (span * span / 2);   // rank of the median in the kernel
+
+      prepare(x0, x1);
+
+      columnCoarse.assign(columns * coarse, 0);
+      columnFine.assign(columns * fine, 0);
+
+      for(ptrdiff_t y = (ptrdiff_t) y0 - (ptrdiff_t) radius; y <= (ptrdiff_t) (y0 + radius); y++)
+      {
+         addRow(y, 1);
+      }
+
+      for(size_t y = y0; y < y1; y++)
+      {
+         if(y > y0)
+         {
+            addRow((ptrdiff_t) y - (ptrdiff_t) radius - 1, -1);
+            addRow((ptrdiff_t) (y + radius), 1);
+         }
+
+         // the column histograms moved down a row, every fine segment of the kernel is stale
+         for(size_t b = 0; b < coarse; b++)
+         {
+            kernelCoarse[b] = 0;
+            synced[b] = -(ptrdiff_t) span;
+         }
+         for(size_t c = 0; c < span; c++)
+         {
+            const uint16_t * add = &columnCoarse[c * coarse];
+            for(size_t b = 0; b < coarse; b++) kernelCoarse[b] += add[b];
+         }
+
+         T * row = out + y * width;
+         for(size_t i = 0; i < x1 - x0; i++)
+         {
+            if(i > 0)
+            {
+               const uint16_t * add = &columnCoarse[(i + span - 1) * coarse];
+               const uint16_t * sub = &columnCoarse[(i - 1) * coarse];
+               for(size_t b = 0; b < coarse; b++) kernelCoarse[b] += add[b] - sub[b];
+            }
+
+            uint32_t below = 0;
+            size_t bin = 0;
+            while(below + kernelCoarse[bin] <= target) below += kernelCoarse[bin++];
+
+            syncSegment(bin, (ptrdiff_t) i);
+
+            const uint32_t * counts = &kernelFine[bin * segment];
+            size_t j = 0;
+            while(below + counts[j] <= target) below += counts[j++];
+
+            row[x0 + i] = (T) (bin * segment + j);
+         }
+      }
+   }
+
+   template <typename T>
+   void ImageMedianTile<T>::addColumn(const size_t * rows, size_t c, int delta)
+   {
+      const size_t span = 2 * radius + 1;
+
+      for(size_t k = 0; k < span; k++)
+      {
+         const T v = (rows[k] == height || source[c] == width) ? T(0) : in[rows[k] * width + source[c]];
+         kernelCoarse[v >> shift] += delta;
+         kernelFine[v] += delta;
+      }
+   }
+
+   // Huang's running histogram: the kernel histogram slides along the row a column at a time, with no per column histograms
+   template <typename T>
+   void ImageMedianTile<T>::slide(size_t x0, size_t x1, size_t y0, size_t y1)
+   {
+      const size_t span = 2 * radius + 1;
+      const uint32_t target = (uint32_t) (span * span / 2);   // rank of the median in the kernel
+      std::vector<size_t> rows(span);
+
+      prepare(x0, x1);
+
+      for(size_t y = y0; y < y1; y++)
+      {
+         for(size_t k = 0; k < span; k++)
+         {
+            rows[k] = padded_index((ptrdiff_t) (y + k) - (ptrdiff_t) radius, height, edge);
+         }
+
+         for(size_t c = 0; c < span; c++) addColumn(rows.data(), c, 1);
+
+         T * row = out + y * width;
+         for(size_t i = 0; i < x1 - x0; i++)
+         {
+            if(i > 0)
+            {
+               addColumn(rows.data(), i - 1, -1);
+               addColumn(rows.data(), i + span - 1, 1);
+            }
+
+            uint32_t below = 0;
+            size_t bin = 0;
+            while(below + kernelCoarse[bin] <= target) below += kernelCoarse[bin++];
+
+            const uint32_t * counts = &kernelFine[bin * segment];
+            size_t j = 0;
+            while(below + counts[j] <= target) below += counts[j++];
+
+            row[x0 + i] = (T) (bin * segment + j);
+         }
+
+         for(size_t c = x1 - x0 - 1; c < x1 - x0 - 1 + span; c++) addColumn(rows.data(), c, -1);   // back to empty for the next row
+      }
+   }
+}
+
+template <typename T>
+void median_filter_2d(const T * in, T * out, size_t width, size_t height, size_t radius, MedianEdgeMode edge, unsigned threads)
+{
+   typedef median_filter_detail::image_histogram<T> Geometry;
+
+   if(width == 0 || height == 0) return;
+   if(radius > 32767) radius = 32767;   // column counts are 16 bit
+
+   if(threads == 0) threads = std::thread::hardware_concurrency();
+   if(threads == 0) threads = 1;
+
+   // tiles of whole columns by bands of rows; every band primes 2 * radius + 1 rows, so keep bands tall against the kernel
+   const bool sliding = radius > Geometry::columnRadius;   // column histograms would not fit, see image_histogram
+   const size_t tileWidth = sliding ? median_filter_detail::slideColumns : Geometry::tileColumns;
+   const size_t strips = (width + tileWidth - 1) / tileWidth;
+
+   size_t bandHeight = height;
+   if(threads > 1 && strips < 4 * (size_t) threads)
+   {
+      bandHeight = (height * strips) / (4 * (size_t) threads) + 1;
+      if(bandHeight < 8 * radius)                                     bandHeight = 8 * radius;
+      if(bandHeight * (width < tileWidth ? width : tileWidth) < MEDIAN_FILTER_MIN_TILE)
+      {
+         bandHeight = MEDIAN_FILTER_MIN_TILE / (width < tileWidth ? width : tileWidth) + 1;
+      }
+      if(bandHeight > height)                                         bandHeight = height;
+   }
+   const size_t bands = (height + bandHeight - 1) / bandHeight;
+
+   const size_t tiles = strips * bands;
+   if(tiles < threads) threads = (unsigned) tiles;
+
+   std::atomic<size_t> nextTile(0);
+
+   auto worker = [&]() {
+      median_filter_detail::ImageMedianTile<T> tile(in, out, width, height, radius, edge);
+
+      for(size_t t = nextTile++; t < tiles; t = nextTile++)
+      {
+         const size_t x0 = (t % strips) * tileWidth;
+         const size_t y0 = (t / strips) * bandHeight;
+         const size_t x1 = (x0 + tileWidth < width) ? x0 + tileWidth : width;
+         const size_t y1 = (y0 + bandHeight < height) ? y0 + bandHeight : height;
+         if(sliding) tile.slide(x0, x1, y0, y1);
+         else tile.run(x0, x1, y0, y1);
+      }
+   };
+
+   std::vector<std::thread> pool;
+   pool.reserve(threads - 1);
+   for(unsigned i = 1; i < threads; i++)
+   {
+      pool.emplace_back(worker);
+   }
+   worker();   // the calling thread works too
+
+   for(std::thread & t : pool)
+   {
+      t.join();
+   }
+}
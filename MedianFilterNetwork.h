@@ -0,0 +1,112 @@
+/*
+  MedianFilterNetwork.h - Median selection networks for small windows, part of the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   Compare-exchange sequences that leave the median of 3, 5, 7 or 9 values in the middle position (index window / 2).
+   They only use min and max, so they run without branches on scalars and on SIMD lanes alike.
+
+   The sequences are lists of CE(i, j) steps, each placing min(p[i], p[j]) in p[i] and max(p[i], p[j]) in p[j], so that every
+   backend (scalar here, SSE / AVX2 in MedianFilterSimd.h) expands the same network with its own compare-exchange.
+   Median of 5, 7 and 9 follow N. Devillard, "Fast median search: an ANSI C implementation", 1998.
+
+   min(a, b) is (a < b) ? a : b and max(a, b) is (a > b) ? a : b, the same operand order as the x86 minps / maxps instructions,
+   so scalar and SIMD results are bit identical for floating point input, NaN and signed zeros included.
+ */
+
+#ifndef MedianFilterNetwork_h
+
+   #define MedianFilterNetwork_h
+
+   #include <stddef.h>
+
+   #define MEDIAN_FILTER_NETWORK_3(CE) \
+      CE(0, 1) CE(1, 2) CE(0, 1)
+
+   #define MEDIAN_FILTER_NETWORK_5(CE) \
+      CE(0, 1) CE(3, 4) CE(0, 3) CE(1, 4) CE(1, 2) CE(2, 3) CE(1, 2)
+
+   #define MEDIAN_FILTER_NETWORK_7(CE) \
+      CE(0, 5) CE(0, 3) CE(1, 6) CE(2, 4) CE(0, 1) CE(3, 5) CE(2, 6) \
+      CE(2, 3) CE(3, 6) CE(4, 5) CE(1, 4) CE(1, 3) CE(3, 4)
+
+   #define MEDIAN_FILTER_NETWORK_9(CE) \
+      CE(1, 2) CE(4, 5) CE(7, 8) CE(0, 1) CE(3, 4) CE(6, 7) CE(1, 2) \
+      CE(4, 5) CE(7, 8) CE(0, 3) CE(5, 8) CE(4, 7) CE(3, 6) CE(1, 4) \
+      CE(2, 5) CE(4, 7) CE(4, 2) CE(6, 4) CE(4, 2)
+
+   namespace median_filter_detail
+   {
+      inline bool is_network_window(size_t window)
+      {
+         return window == 3 || window == 5 || window == 7 || window == 9;
+      }
+
+      template <typename T>
+      inline T network_min(const T & a, const T & b)
+      {
+         return (a < b) ? a : b;
+      }
+
+      template <typename T>
+      inline T network_max(const T & a, const T & b)
+      {
+         return (a > b) ? a : b;
+      }
+
+      #define MEDIAN_FILTER_SCALAR_CE(i, j) \
+         { const T lo = network_min(p[i], p[j]); p[j] = network_max(p[i], p[j]); p[i] = lo; }
+
+      // NetworkMedian<Window, T>::run(p) returns the median of p[0] .. p[Window - 1], p is used as scratch
+      template <size_t Window, typename T>
+      struct NetworkMedian;
+
+      template <typename T>
+      struct NetworkMedian<3, T> { static T run(T * p) { MEDIAN_FILTER_NETWORK_3(MEDIAN_FILTER_SCALAR_CE) return p[1]; } };
+
+      template <typename T>
+      struct NetworkMedian<5, T> { static T run(T * p) { MEDIAN_FILTER_NETWORK_5(MEDIAN_FILTER_SCALAR_CE) return p[2]; } };
+
+      template <typename T>
+      struct NetworkMedian<7, T> { static T run(T * p) { MEDIAN_FILTER_NETWORK_7(MEDIAN_FILTER_SCALAR_CE) return p[3]; } };
+
+      template <typename T>
+      struct NetworkMedian<9, T> { static T run(T * p) { MEDIAN_FILTER_NETWORK_9(MEDIAN_FILTER_SCALAR_CE) return p[4]; } };
+
+      #undef MEDIAN_FILTER_SCALAR_CE
+
+      // median of `window` values spaced `stride` apart, window must pass is_network_window()
+      template <typename T>
+      inline T network_median(const T * values, size_t window, size_t stride)
+      {
+         T p[9];
+         for(size_t i = 0; i < window; i++)
+         {
+            p[i] = values[i * stride];
+         }
+
+         switch(window)
+         {
+            case 3:  return NetworkMedian<3, T>::run(p);
+            case 5:  return NetworkMedian<5, T>::run(p);
+            case 7:  return NetworkMedian<7, T>::run(p);
+            default: return NetworkMedian<9, T>::run(p);
+         }
+      }
+   }
+
+#endif
@@ -0,0 +1,55 @@
+/*
+  MedianFilterOffline.h - Whole signal median filter for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   median_filter() filters a complete recorded signal in one call, in the manner of scipy.signal.medfilt.
+
+   out[i] is the median of the window of `window` samples centred on in[i], that is in[i - window/2] .. in[i - window/2 + window - 1].
+   For an even window the upper of the two middle samples is returned, the same sample MedianFilter::out() reports.
+   Samples outside the signal are supplied by the edge mode:
+      MedianEdgeMode::Zero    - zero padding (scipy.signal.medfilt)
+      MedianEdgeMode::Nearest - the first / last sample is repeated
+      MedianEdgeMode::Reflect - the signal is mirrored about its ends (d c b a | a b c d | d c b a)
+
+   The signal is cut into blocks of `window` samples that are sorted once each.  Every window is the tail of one block plus the head
+   of the next, so the median is tracked by walking two sorted linked lists while one sample leaves the first block and one enters
+   the second (J. Suomela, "Median filtering is equivalent to sorting", 2014).  Cost is O(n log window) and the working set is
+   four window sized arrays, independent of n.
+
+   NaN samples sort above every number.  `in` and `out` must not overlap.
+ */
+
+#ifndef MedianFilterOffline_h
+
+   #define MedianFilterOffline_h
+
+   #include "MedianFilter.h"
+
+   enum class MedianEdgeMode : uint8_t
+   {
+      Zero,
+      Nearest,
+      Reflect
+   };
+
+   template <typename T>
+   void median_filter(const T * in, T * out, size_t n, size_t window, MedianEdgeMode edge = MedianEdgeMode::Zero);
+
+#include "MedianFilterOffline.hpp"
+
+#endif
@@ -0,0 +1,214 @@
+/*
+   MedianFilterOffline.hpp - Whole signal median filter for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MedianFilterOffline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace median_filter_detail
+{
+   // sample at padded position p, the padded signal starts window/2 samples before in[0]
+   template <typename T>
+   inline T padded_sample(const T * in, size_t n, size_t window, size_t p, MedianEdgeMode edge)
+   {
+      const size_t half = window / 2;
+
+      if(p >= half && p - half < n) return in[p - half];
+
+      switch(edge)
+      {
+         case MedianEdgeMode::Nearest:
+            return (p < half) ? in[0] : in[n - 1];
+
+         case MedianEdgeMode::Reflect:
+         {
+            // position relative to in[0], folded into one period of the mirrored signal
+            const size_t period = 2 * n;
+            size_t q = (p >= half) ? (p - half) % period : (period - (half - p) % period) % period;
+            return (q < n) ? in[q] : in[period - 1 - q];
+         }
+
+         default:
+            return T(0);
+      }
+   }
+
+   // one block of the padded signal: its samples in sorted order plus a doubly linked list over the sorted ranks
+   template <typename T>
+   struct MedianBlock
+   {
+      std::vector<T> sorted;        // block samples by rank
+      std::vector<size_t> rank;     // rank of the sample at each block position
+      std::vector<size_t> next;     // list links by rank, entry `size` is the head / tail sentinel
+      std::vector<size_t> prev;
+
+      explicit MedianBlock(size_t size) : sorted(size), rank(size), next(size + 1), prev(size + 1) {}
+
+      void load(const T * in, size_t n, size_t window, size_t start, MedianEdgeMode edge, std::vector<T> & raw, std::vector<size_t> & order)
+      {
+         const size_t size = sorted.size();
+
+         for(size_t j = 0; j < size; j++)
+         {
+            raw[j] = padded_sample(in, n, window, start + j, edge);
+            order[j] = j;
+         }
+
+         // ties keep block position order so ranks are a strict total order
+         std::sort(order.begin(), order.end(), [&raw](size_t x, size_t y) {
+            if(ordered_less(raw[x], raw[y])) return true;
+            if(ordered_less(raw[y], raw[x])) return false;
+            return x < y;
+         });
+
+         for(size_t r = 0; r < size; r++)
+         {
+            sorted[r] = raw[order[r]];
+            rank[order[r]] = r;
+         }
+      }
+
+      void link()
+      {
+         const size_t size = sorted.size();
+         for(size_t r = 0; r <= size; r++)
+         {
+            next[r] = (r == size) ? 0 : r + 1;
+            prev[r] = (r == 0) ? size : r - 1;
+         }
+      }
+
+      void unlink(size_t r)
+      {
+         next[prev[r]] = next[r];
+         prev[next[r]] = prev[r];
+      }
+
+      void relink(size_t r)   // undo unlink(), only valid in reverse order of the unlinks
+      {
+         next[prev[r]] = r;
+         prev[next[r]] = r;
+      }
+   };
+}
+
+namespace median_filter_detail
+{
+   // out[first] .. out[last - 1] of median_filter(), every output only depends on its own window so ranges can run independently
+   template <typename T>
+   void median_filter_range(const T * in, T * out, size_t n, size_t window, MedianEdgeMode edge, size_t first, size_t last)
+   {
+      const size_t half = window >> 1;     // rank of the median inside a window
+      const size_t end  = window;          // list sentinel, also stands for "past the last sample"
+
+      MedianBlock<T> A(window);   // block the window is leaving
+      MedianBlock<T> B(window);   // block the window is entering
+      std::vector<T> raw(window);
+      std::vector<size_t> order(window);
+
+      A.load(in, n, window, first, edge, raw, order);
+
+      // A rank is less than a B rank when its sample is smaller, equal samples order A first since A is older
+      auto aBeforeB = [&A, &B, end](size_t ra, size_t rb) {
+         if(ra == end) return false;
+         if(rb == end) return true;
+         return !ordered_less(B.sorted[rb], A.sorted[ra]);
+      };
+
+      for(size_t start = first; start < last; start += window)
+      {
+         A.link();
+         B.load(in, n, window, start + window, edge, raw, order);
+         B.link();
+         for(size_t j = window; j-- > 0; )   // B starts empty, its samples are relinked in position order
+         {
+            B.unlink(B.rank[j]);
+         }
+
+         // a and b point at the smallest "large" sample of each list, the s samples before them are the s smallest of the window
+         size_t a = half;
+         size_t b = end;
+         size_t s = half;
+
+         auto retreat = [&]() {     // largest small sample becomes large
+            size_t pa = A.prev[a];
+            size_t pb = B.prev[b];
+            if(pb == end)                 a = pa;
+            else if(pa == end)            b = pb;
+            else if(aBeforeB(pa, pb))     b = pb;
+            else                          a = pa;
+            s--;
+         };
+
+         auto advance = [&]() {     // smallest large sample becomes small
+            if(aBeforeB(a, b)) a = A.next[a];
+            else               b = B.next[b];
+            s++;
+         };
+
+         auto misplaced = [&]() {   // a small sample of one list is above a large sample of the other
+            size_t pa = A.prev[a];
+            size_t pb = B.prev[b];
+            return (pa != end && b != end && !aBeforeB(pa, b)) || (pb != end && a != end && aBeforeB(a, pb));
+         };
+
+         for(size_t j = 0; j < window && start + j < last; j++)
+         {
+            if(j > 0)
+            {
+               const size_t ra = A.rank[j - 1];   // sample leaving the window
+               if(ra == a)     a = A.next[a];
+               else if(ra < a) s--;
+               A.unlink(ra);
+
+               const size_t rb = B.rank[j - 1];   // sample entering the window
+               B.relink(rb);
+               if(rb < b) s++;
+
+               while(s > half) retreat();
+               while(s < half) advance();
+               while(misplaced())
+               {
+                  retreat();
+                  advance();
+               }
+            }
+
+            out[start + j] = aBeforeB(a, b) ? A.sorted[a] : B.sorted[b];
+         }
+
+         std::swap(A, B);
+      }
+   }
+}
+
+template <typename T>
+void median_filter(const T * in, T * out, size_t n, size_t window, MedianEdgeMode edge)
+{
+   if(n == 0) return;
+
+   if(window <= 1)
+   {
+      std::copy(in, in + n, out);
+      return;
+   }
+
+   median_filter_detail::median_filter_range(in, out, n, window, edge, 0, n);
+}
@@ -0,0 +1,40 @@
+/*
+  MedianFilterParallel.h - Multi-threaded whole signal median filter for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   median_filter_parallel() produces exactly the output of median_filter() using several threads.
+
+   The output is cut into chunks.  A chunk reads window - 1 samples past its own range (window / 2 on each side), so each chunk
+   primes its first window from the neighbouring input and no chunk depends on another.  Chunks are handed out to a pool of
+   worker threads from a shared counter.  threads == 0 uses std::thread::hardware_concurrency().
+
+   Requires a host platform with std::thread, it is not included by MedianFilter.h.
+ */
+
+#ifndef MedianFilterParallel_h
+
+   #define MedianFilterParallel_h
+
+   #include "MedianFilterOffline.h"
+
+   template <typename T>
+   void median_filter_parallel(const T * in, T * out, size_t n, size_t window, MedianEdgeMode edge = MedianEdgeMode::Zero, unsigned threads = 0);
+
+#include "MedianFilterParallel.hpp"
+
+#endif
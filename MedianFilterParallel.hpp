@@ -0,0 +1,80 @@
+/*
+   MedianFilterParallel.hpp - Multi-threaded whole signal median filter for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MedianFilterParallel.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifndef MEDIAN_FILTER_MIN_CHUNK
+   #define MEDIAN_FILTER_MIN_CHUNK 65536   // smallest chunk worth a hand-off, in samples
+#endif
+
+template <typename T>
+void median_filter_parallel(const T * in, T * out, size_t n, size_t window, MedianEdgeMode edge, unsigned threads)
+{
+   if(threads == 0) threads = std::thread::hardware_concurrency();
+   if(threads == 0) threads = 1;
+
+   if(n == 0) return;
+
+   if(window <= 1)
+   {
+      std::copy(in, in + n, out);
+      return;
+   }
+
+   // every chunk repeats the sort of one extra block, keep chunks large against the window so that overhead stays small
+   size_t chunk = n / (4 * (size_t) threads) + 1;
+   if(chunk < MEDIAN_FILTER_MIN_CHUNK) chunk = MEDIAN_FILTER_MIN_CHUNK;
+   if(chunk < 8 * window)              chunk = 8 * window;
+
+   const size_t chunks = (n + chunk - 1) / chunk;
+   if(chunks < threads) threads = (unsigned) chunks;
+
+   if(threads <= 1)
+   {
+      median_filter_detail::median_filter_range(in, out, n, window, edge, 0, n);
+      return;
+   }
+
+   std::atomic<size_t> nextChunk(0);
+
+   auto worker = [&]() {
+      for(size_t c = nextChunk++; c < chunks; c = nextChunk++)
+      {
+         const size_t first = c * chunk;
+         const size_t last  = (first + chunk < n) ? first + chunk : n;
+         median_filter_detail::median_filter_range(in, out, n, window, edge, first, last);
+      }
+   };
+
+   std::vector<std::thread> pool;
+   pool.reserve(threads - 1);
+   for(unsigned i = 1; i < threads; i++)
+   {
+      pool.emplace_back(worker);
+   }
+   worker();   // the calling thread works too
+
+   for(std::thread & t : pool)
+   {
+      t.join();
+   }
+}
@@ -0,0 +1,158 @@
+/*
+  MedianFilterPlatform.h - Platform shim for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   Arduino builds (the IDE and arduino-cli define ARDUINO) include Arduino.h and clamp with its constrain() macro, exactly as
+   before.  avr-gcc ships no C++ standard library, so on this path no C++ standard header is included: the few type traits
+   and integer limits the filters need are defined below, and the floating point tests come from math.h.  Everywhere else the
+   library needs only the C and C++ standard headers, the traits forward to them and clamp uses std::clamp (C++17) or an
+   equivalent comparison.  Define MEDIAN_FILTER_USE_ARDUINO_H to force the Arduino path, e.g. for a board core built outside
+   the Arduino tools.
+
+   The limits are named lowest() / highest() since Arduino.h defines min and max as macros.
+ */
+
+#ifndef MedianFilterPlatform_h
+
+   #define MedianFilterPlatform_h
+
+   #if defined(ARDUINO) || defined(MEDIAN_FILTER_USE_ARDUINO_H)
+      #define MEDIAN_FILTER_ARDUINO 1
+   #else
+      #define MEDIAN_FILTER_ARDUINO 0
+   #endif
+
+   #if MEDIAN_FILTER_ARDUINO
+      #include "Arduino.h"
+   #else
+      #include <stddef.h>
+      #include <stdint.h>
+      #include <stdlib.h>
+      #include <string.h>
+      #include <algorithm>
+      #include <array>
+      #include <cmath>
+      #include <cstdint>
+      #include <iterator>
+      #include <limits>
+      #include <type_traits>
+   #endif
+
+   namespace median_filter_detail
+   {
+      // value limited to [low, high]
+      template <typename T>
+      inline T clamp(T value, T low, T high)
+      {
+      #if MEDIAN_FILTER_ARDUINO
+         return constrain(value, low, high);
+      #elif __cplusplus >= 201703L
+         return std::clamp(value, low, high);
+      #else
+         return (value < low) ? low : (high < value) ? high : value;
+      #endif
+      }
+
+   #if MEDIAN_FILTER_ARDUINO
+      template <bool B, typename T, typename F> struct conditional { typedef T type; };
+      template <typename T, typename F> struct conditional<false, T, F> { typedef F type; };
+
+      template <typename T, T v> struct integral_constant { static constexpr T value = v; };
+
+      template <typename A, typename B> struct is_same : integral_constant<bool, false> {};
+      template <typename A> struct is_same<A, A> : integral_constant<bool, true> {};
+
+      template <typename T> struct is_integral : integral_constant<bool, false> {};
+      template <typename T> struct is_integral<const T> : is_integral<T> {};
+      #define MEDIAN_FILTER_INTEGRAL(T) template <> struct is_integral<T> : integral_constant<bool, true> {};
+      MEDIAN_FILTER_INTEGRAL(bool)
+      MEDIAN_FILTER_INTEGRAL(char)
+      MEDIAN_FILTER_INTEGRAL(signed char)
+      MEDIAN_FILTER_INTEGRAL(unsigned char)
+      MEDIAN_FILTER_INTEGRAL(short)
+      MEDIAN_FILTER_INTEGRAL(unsigned short)
+      MEDIAN_FILTER_INTEGRAL(int)
+      MEDIAN_FILTER_INTEGRAL(unsigned int)
+      MEDIAN_FILTER_INTEGRAL(long)
+      MEDIAN_FILTER_INTEGRAL(unsigned long)
+      MEDIAN_FILTER_INTEGRAL(long long)
+      MEDIAN_FILTER_INTEGRAL(unsigned long long)
+      #undef MEDIAN_FILTER_INTEGRAL
+
+      // range of an integer type, two's complement
+      template <typename T>
+      struct limits
+      {
+         static constexpr bool is_integer = is_integral<T>::value;
+         static constexpr bool is_signed = T(-1) < T(0);
+
+         static constexpr T highest() { return is_signed ? T((((unsigned long long) 1) << (8 * sizeof(T) - 1)) - 1) : T(~0ULL); }
+         static constexpr T lowest()  { return is_signed ? T(-highest() - 1) : T(0); }
+      };
+
+      struct forward_iterator_tag {};
+
+      // fixed size array member, what std::array is used for on the host
+      template <typename T, size_t N>
+      struct array
+      {
+         T elements[N];
+
+         T & operator[](size_t i) { return elements[i]; }
+         const T & operator[](size_t i) const { return elements[i]; }
+         T * data() { return elements; }
+         const T * data() const { return elements; }
+      };
+
+      template <typename T>
+      struct array<T, 0>
+      {
+         T * data() { return nullptr; }
+         const T * data() const { return nullptr; }
+      };
+
+      template <typename F> inline bool is_nan(F v) { return isnan(v); }
+      template <typename F> inline bool sign_bit(F v) { return signbit(v); }
+      inline double square_root(double v) { return sqrt(v); }
+   #else
+      using std::conditional;
+      using std::integral_constant;
+      using std::is_same;
+      using std::is_integral;
+      using std::forward_iterator_tag;
+
+      template <typename T, size_t N>
+      using array = std::array<T, N>;
+
+      template <typename T>
+      struct limits
+      {
+         static constexpr bool is_integer = std::numeric_limits<T>::is_integer;
+         static constexpr bool is_signed = std::numeric_limits<T>::is_signed;
+
+         static constexpr T highest() { return std::numeric_limits<T>::max(); }
+         static constexpr T lowest()  { return std::numeric_limits<T>::lowest(); }
+      };
+
+      template <typename F> inline bool is_nan(F v) { return std::isnan(v); }
+      template <typename F> inline bool sign_bit(F v) { return std::signbit(v); }
+      inline double square_root(double v) { return std::sqrt(v); }
+   #endif
+   }
+
+#endif
@@ -0,0 +1,147 @@
+/*
+  MedianFilterSharded.h - Per-thread sharded median filter for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   ShardedMedianFilter gives every worker thread its own MedianFilter and merges their windows on demand.
+
+   Worker i owns shard(i) and is the only thread that calls its in().  in() feeds the shard's filter and otherwise only
+   checks a request flag, so the per sample path costs the same as MedianFilter::in(), takes no lock and never waits.
+   A shard publishes resolution evenly spaced order statistics of its window (always including its minimum and maximum)
+   through a per shard sequence lock, in one O(size) walk of its sorted window, only when
+      - a query has asked for it since the last publish (at the shard's next in()),
+      - interval samples have passed since the last publish (interval 0, the default, means one window, so the walk costs
+        about one step per sample), or
+      - the owner calls publish(), e.g. before it goes idle.
+
+   Any thread may query the global window.  A query asks every shard to publish and waits up to MEDIAN_FILTER_SHARD_WAIT
+   microseconds for the shards to answer, so a shard whose worker is still feeding samples is merged as of its next in().
+   A shard that left the previous query's request unanswered is idle and is not waited for; it is merged as of its last
+   publish, which is at most interval samples behind its window.  The aggregator merges the shards that have published a
+   sample with a k-way merge over the already sorted shard lists, selecting only as far as the highest rank asked for.  With resolution equal to the window size the result is exact
+   (the order statistics of all published shard windows pooled together); a smaller resolution trades accuracy for a
+   cheaper publish.
+
+   Each shard's published state sits on cache lines of its own.  The filters' sample storage and the published points come
+   from Allocator; an allocator returning a null pointer makes the constructor throw std::bad_alloc.
+
+   Requires a host platform with <atomic> and <vector>, it is not included by MedianFilter.h.
+ */
+
+#ifndef MedianFilterSharded_h
+
+   #define MedianFilterSharded_h
+
+   #include "MedianFilter.h"
+
+   #include <atomic>
+   #include <memory>
+   #include <vector>
+
+   #ifndef MEDIAN_FILTER_SHARD_RESOLUTION
+      #define MEDIAN_FILTER_SHARD_RESOLUTION 32   // default number of order statistics a shard publishes
+   #endif
+
+   #ifndef MEDIAN_FILTER_SHARD_WAIT
+      #define MEDIAN_FILTER_SHARD_WAIT 100   // microseconds a query waits for active shards to publish, 0 = never wait
+   #endif
+
+   namespace median_filter_detail
+   {
+      // merges lists sorted runs of length values each, stored back to back, into the first prefix values of merged
+      template <typename T>
+      void merge_prefix(const T * runs, size_t lists, size_t length, T * merged, size_t prefix);
+   }
+
+   template <typename T, typename Sum, typename Index = uint8_t, typename Allocator = median_filter_detail::CallocAllocator<unsigned char> >
+   class ShardedMedianFilter
+   {
+      public:
+         class Shard
+         {
+            public:
+               ~Shard();
+
+               // owning worker thread only
+               T in(const T & value);                       // filters, publishes when asked to, returns the shard median
+               void in(const T * src, T * dst, size_t n);   // filters the buffer, publishes at the end when asked to
+               void publish();
+               void reset(T seed);
+               const MedianFilter<T, Sum, Index, Allocator> & filter() const;
+
+               // any thread
+               uint64_t count() const;   // samples given to in() up to the last publish
+               bool pending() const;     // a query's request is waiting for the next publish
+
+            private:
+               friend class ShardedMedianFilter;
+
+               Shard(size_t size, T seed, size_t resolution, size_t interval, MedianFilterEngine engine, const Allocator & allocator);
+               Shard(const Shard &) = delete;
+               Shard & operator=(const Shard &) = delete;
+
+               bool copy(T * points) const;   // false when the shard had not taken a sample at its last publish
+               bool request() const;          // false when the previous request is still pending, the shard is idle
+
+               typedef typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char> ByteAllocator;
+
+               MedianFilter<T, Sum, Index, Allocator> window;
+               size_t span;            // window length
+               size_t interval;        // samples between unrequested publishes
+               size_t sincePublish;
+               uint64_t taken;
+               ByteAllocator byteAllocator;
+               size_t storageBytes;    // of pointStorage
+
+               // published state, written by the owner, read by the aggregator
+               char separator[MEDIAN_FILTER_CACHE_LINE];   // keeps the filter's own fields off the published cache line
+               std::atomic<uint32_t> sequence;             // odd while the owner is storing
+               std::atomic<uint64_t> published;
+               mutable std::atomic<bool> requested;        // set by a query, cleared by the next publish
+               size_t pointCount;
+               std::atomic<T> * points;                    // cache line aligned and padded, inside pointStorage
+               unsigned char * pointStorage;
+               char trailer[MEDIAN_FILTER_CACHE_LINE];     // keeps the next heap block off the published cache line
+         };
+
+         ShardedMedianFilter(size_t shards, size_t size, T seed, size_t resolution = MEDIAN_FILTER_SHARD_RESOLUTION, size_t interval = 0,
+                             MedianFilterEngine engine = MedianFilterEngine::Auto, const Allocator & allocator = Allocator());
+
+         Shard & shard(size_t i);
+         const Shard & shard(size_t i) const;
+         size_t shards() const;
+         size_t resolution() const;
+
+         // any thread, merged over the shards that had taken a sample at their last publish (all shards before that), after
+         // asking every shard to publish and waiting up to MEDIAN_FILTER_SHARD_WAIT microseconds for the active ones
+         T out() const;
+         T getMin() const;
+         T getMax() const;
+         Sum getQuantile(double p) const;   // p in [0, 1], linear interpolation between merged ranks
+         void getQuantiles(const double * p, Sum * quantiles, size_t count) const;
+         uint64_t count() const;            // samples taken by all shards up to their last publish
+
+      private:
+         size_t collect(std::vector<T> & points) const;   // returns the number of lists copied
+
+         size_t pointsPerShard;
+         std::vector<std::unique_ptr<Shard> > shardList;
+   };
+
+#include "MedianFilterSharded.hpp"
+
+#endif
@@ -0,0 +1,357 @@
+/*
+   MedianFilterSharded.hpp - Per-thread sharded median filter for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MedianFilterSharded.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace median_filter_detail
+{
+   template <typename T>
+   void merge_prefix(const T * runs, size_t lists, size_t length, T * merged, size_t prefix)
+   {
+      // min heap of (value, run) heads, each run advances past its own end only when it is exhausted
+      typedef std::pair<T, size_t> Head;
+      std::vector<Head> heads;
+      std::vector<size_t> next(lists, 1);
+      heads.reserve(lists);
+
+      for(size_t i = 0; i < lists; i++)
+      {
+         if(length > 0) heads.push_back(Head(runs[i * length], i));
+      }
+
+      std::greater<Head> later;
+      std::make_heap(heads.begin(), heads.end(), later);
+
+      for(size_t k = 0; k < prefix && !heads.empty(); k++)
+      {
+         std::pop_heap(heads.begin(), heads.end(), later);
+         const size_t run = heads.back().second;
+         merged[k] = heads.back().first;
+
+         if(next[run] < length)
+         {
+            heads.back().first = runs[run * length + next[run]++];
+            std::push_heap(heads.begin(), heads.end(), later);
+         }
+         else
+         {
+            heads.pop_back();
+         }
+      }
+   }
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::Shard(size_t size, T seed, size_t resolution, size_t interval, MedianFilterEngine engine, const Allocator & allocator) :
+   window(size, seed, engine, allocator),
+   span { median_filter_detail::clamp(size, (size_t) 3, (size_t) std::numeric_limits<Index>::max()) },   // as MedianFilter clamps it
+   interval { interval == 0 ? span : interval },   // one window by default
+   sincePublish { 0 },
+   taken { 0 },
+   byteAllocator ( allocator ),
+   pointCount { resolution }
+{
+   // whole cache lines for the points, so no other allocation shares them
+   const size_t line  = MEDIAN_FILTER_CACHE_LINE;
+   storageBytes = (pointCount * sizeof(std::atomic<T>) + line - 1) / line * line + line - 1;
+   pointStorage = std::allocator_traits<ByteAllocator>::allocate(byteAllocator, storageBytes);
+   if(!pointStorage) throw std::bad_alloc();   // CallocAllocator reports a failure with a null pointer
+   points = (std::atomic<T>*) (((uintptr_t) pointStorage + line - 1) / line * line);
+   for(size_t j = 0; j < pointCount; j++) new (&points[j]) std::atomic<T>();
+
+   sequence.store(0, std::memory_order_relaxed);
+   requested.store(false, std::memory_order_relaxed);
+   publish();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::~Shard()
+{
+   std::allocator_traits<ByteAllocator>::deallocate(byteAllocator, pointStorage, storageBytes);   // std::atomic<T> of an arithmetic T needs no destructor call
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::publish()
+{
+   const size_t stride = pointCount - 1;
+
+   requested.store(false, std::memory_order_relaxed);   // a request arriving from here on is served by the next publish
+   sincePublish = 0;
+
+   // sequence lock write side: odd count, fence, relaxed stores, even count with release
+   const uint32_t current = sequence.load(std::memory_order_relaxed);
+   sequence.store(current + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+
+   if(stride == 0)
+   {
+      points[0].store(window.out(), std::memory_order_relaxed);
+   }
+   else
+   {
+      // one walk of the sorted window picks the evenly spaced ranks, first is the minimum, last the maximum
+      size_t j = 0, rank = 0, next = 0;
+      for(const T & value : window.sorted())
+      {
+         while(j <= stride && rank == next)
+         {
+            points[j++].store(value, std::memory_order_relaxed);
+            next = (j * (span - 1) + stride / 2) / stride;
+         }
+         if(j > stride) break;
+         rank++;
+      }
+   }
+   published.store(taken, std::memory_order_relaxed);
+
+   sequence.store(current + 2, std::memory_order_release);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+bool ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::request() const
+{
+   if(requested.load(std::memory_order_relaxed)) return false;   // no write while still pending
+   requested.store(true, std::memory_order_relaxed);
+   return true;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+bool ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::pending() const
+{
+   return requested.load(std::memory_order_relaxed);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+bool ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::copy(T * destination) const
+{
+   for(;;)
+   {
+      // sequence lock read side: retry while a publish is in progress or overlapped the copy
+      const uint32_t before = sequence.load(std::memory_order_acquire);
+      if(before & 1) continue;
+
+      const uint64_t samples = published.load(std::memory_order_relaxed);
+      for(size_t j = 0; j < pointCount; j++)
+      {
+         destination[j] = points[j].load(std::memory_order_relaxed);
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(sequence.load(std::memory_order_relaxed) == before) return samples > 0;
+   }
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::in(const T & value)
+{
+   const T median = window.in(value);
+   taken++;
+   sincePublish++;
+   if(requested.load(std::memory_order_relaxed) || sincePublish == interval) publish();
+   return median;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::in(const T * src, T * dst, size_t n)
+{
+   window.in(src, dst, n);
+   taken += n;
+   sincePublish += n;
+   if(requested.load(std::memory_order_relaxed) || sincePublish >= interval) publish();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::reset(T seed)
+{
+   window.reset(seed);
+   taken = 0;
+   publish();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+const MedianFilter<T, Sum, Index, Allocator> & ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::filter() const
+{
+   return window;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+uint64_t ShardedMedianFilter<T, Sum, Index, Allocator>::Shard::count() const
+{
+   return published.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+ShardedMedianFilter<T, Sum, Index, Allocator>::ShardedMedianFilter(size_t shards, size_t size, T seed, size_t resolution, size_t interval,
+                                                                   MedianFilterEngine engine, const Allocator & allocator)
+{
+   if(shards == 0) shards = 1;
+
+   const size_t window = median_filter_detail::clamp(size, (size_t) 3, (size_t) std::numeric_limits<Index>::max());
+   pointsPerShard = resolution < 1 ? 1 : (resolution > window ? window : resolution);
+
+   shardList.reserve(shards);
+   for(size_t i = 0; i < shards; i++)
+   {
+      shardList.push_back(std::unique_ptr<Shard>(new Shard(size, seed, pointsPerShard, interval, engine, allocator)));
+   }
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+typename ShardedMedianFilter<T, Sum, Index, Allocator>::Shard & ShardedMedianFilter<T, Sum, Index, Allocator>::shard(size_t i)
+{
+   return *shardList[i];
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+const typename ShardedMedianFilter<T, Sum, Index, Allocator>::Shard & ShardedMedianFilter<T, Sum, Index, Allocator>::shard(size_t i) const
+{
+   return *shardList[i];
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+size_t ShardedMedianFilter<T, Sum, Index, Allocator>::shards() const
+{
+   return shardList.size();
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+size_t ShardedMedianFilter<T, Sum, Index, Allocator>::resolution() const
+{
+   return pointsPerShard;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+size_t ShardedMedianFilter<T, Sum, Index, Allocator>::collect(std::vector<T> & points) const
+{
+   points.resize(shardList.size() * pointsPerShard);
+
+   // ask every shard for a fresh publish, and give the ones that answered the previous request a bounded time to answer this one
+   std::vector<bool> active(shardList.size());
+   for(size_t i = 0; i < shardList.size(); i++) active[i] = shardList[i]->request();
+
+   const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(MEDIAN_FILTER_SHARD_WAIT);
+   for(size_t i = 0; i < shardList.size(); i++)
+   {
+      while(active[i] && shardList[i]->pending() && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+   }
+
+   size_t lists = 0;
+   for(size_t i = 0; i < shardList.size(); i++)
+   {
+      if(shardList[i]->copy(&points[lists * pointsPerShard])) lists++;   // an idle shard is overwritten by the next one
+   }
+
+   if(lists == 0)   // nothing taken yet, every shard still holds its seed
+   {
+      for(size_t i = 0; i < shardList.size(); i++) shardList[i]->copy(&points[i * pointsPerShard]);
+      lists = shardList.size();
+   }
+
+   return lists;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ShardedMedianFilter<T, Sum, Index, Allocator>::out() const
+{
+   std::vector<T> points;
+   const size_t lists = collect(points);
+   const size_t rank  = (lists * pointsPerShard) / 2;   // same rank as MedianFilter::out() for an odd total
+
+   std::vector<T> merged(rank + 1);
+   median_filter_detail::merge_prefix(points.data(), lists, pointsPerShard, merged.data(), rank + 1);
+   return merged[rank];
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ShardedMedianFilter<T, Sum, Index, Allocator>::getMin() const
+{
+   std::vector<T> points;
+   const size_t lists = collect(points);
+
+   T lowest = points[0];
+   for(size_t i = 1; i < lists; i++)
+   {
+      if(points[i * pointsPerShard] < lowest) lowest = points[i * pointsPerShard];
+   }
+   return lowest;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+T ShardedMedianFilter<T, Sum, Index, Allocator>::getMax() const
+{
+   std::vector<T> points;
+   const size_t lists = collect(points);
+
+   T highest = points[pointsPerShard - 1];
+   for(size_t i = 1; i < lists; i++)
+   {
+      if(highest < points[i * pointsPerShard + pointsPerShard - 1]) highest = points[i * pointsPerShard + pointsPerShard - 1];
+   }
+   return highest;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+Sum ShardedMedianFilter<T, Sum, Index, Allocator>::getQuantile(double p) const
+{
+   Sum quantile;
+   getQuantiles(&p, &quantile, 1);
+   return quantile;
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+void ShardedMedianFilter<T, Sum, Index, Allocator>::getQuantiles(const double * p, Sum * quantiles, size_t count) const
+{
+   if(count == 0) return;
+
+   std::vector<T> points;
+   const size_t lists = collect(points);
+   const size_t total = lists * pointsPerShard;
+
+   size_t prefix = 0;   // merge only as far as the highest rank asked for
+   for(size_t i = 0; i < count; i++)
+   {
+      const median_filter_detail::QuantilePosition q(p[i], total);
+      const size_t needed = q.rank + (q.fraction == 0.0 ? 1 : 2);
+      if(needed > prefix) prefix = needed;
+   }
+
+   std::vector<T> merged(prefix);
+   median_filter_detail::merge_prefix(points.data(), lists, pointsPerShard, merged.data(), prefix);
+
+   for(size_t i = 0; i < count; i++)
+   {
+      const median_filter_detail::QuantilePosition q(p[i], total);
+      if(q.fraction == 0.0) quantiles[i] = (Sum) merged[q.rank];
+      else quantiles[i] = median_filter_detail::interpolate<Sum>(merged[q.rank], merged[q.rank + 1], q.fraction);
+   }
+}
+
+template <typename T, typename Sum, typename Index, typename Allocator>
+uint64_t ShardedMedianFilter<T, Sum, Index, Allocator>::count() const
+{
+   uint64_t total = 0;
+   for(size_t i = 0; i < shardList.size(); i++) total += shardList[i]->count();
+   return total;
+}
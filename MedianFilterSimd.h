@@ -0,0 +1,183 @@
+/*
+  MedianFilterSimd.h - SIMD median of small windows across channels, part of the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   network_medians() computes the median of every column of a window x channels block of samples (rows `channels` apart, as
+   stored by MedianFilterBank) with the selection networks of MedianFilterNetwork.h, one channel per SIMD lane.
+
+   On x86 with GCC or Clang the AVX2 or SSE4.1 path is picked at run time from the CPU features, the code is compiled with
+   per-function target attributes so no -mavx2 / -msse4.1 flag is needed.  Channels left over after the last full vector,
+   unsupported sample types and every other platform use the scalar network, which gives bit identical results.
+
+   Vectorised sample types: int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t, float, double.
+   Define MEDIAN_FILTER_NO_SIMD to always use the scalar network.
+ */
+
+#ifndef MedianFilterSimd_h
+
+   #define MedianFilterSimd_h
+
+   #include "MedianFilterPlatform.h"
+   #include "MedianFilterNetwork.h"
+
+   #if !defined(MEDIAN_FILTER_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+      #define MEDIAN_FILTER_X86_SIMD 1
+      #include <immintrin.h>
+   #endif
+
+   namespace median_filter_detail
+   {
+   #ifdef MEDIAN_FILTER_X86_SIMD
+
+      #define MEDIAN_FILTER_LANE(LANE, TARGET, T, V, LOAD, STORE, MIN, MAX) \
+         template <> struct LANE<T> \
+         { \
+            typedef V Vector; \
+            enum { lanes = sizeof(V) / sizeof(T) }; \
+            __attribute__((target(TARGET))) static inline V load(const T * p) { return LOAD; } \
+            __attribute__((target(TARGET))) static inline void store(T * p, V v) { STORE; } \
+            __attribute__((target(TARGET))) static inline V lower(V a, V b) { return MIN(a, b); } \
+            __attribute__((target(TARGET))) static inline V upper(V a, V b) { return MAX(a, b); } \
+         };
+
+      template <typename T> struct Sse41Lane { enum { lanes = 0 }; };
+      template <typename T> struct Avx2Lane  { enum { lanes = 0 }; };
+
+      #define MEDIAN_FILTER_SSE_LOAD_I  _mm_loadu_si128((const __m128i *) p)
+      #define MEDIAN_FILTER_SSE_STORE_I _mm_storeu_si128((__m128i *) p, v)
+      #define MEDIAN_FILTER_AVX_LOAD_I  _mm256_loadu_si256((const __m256i *) p)
+      #define MEDIAN_FILTER_AVX_STORE_I _mm256_storeu_si256((__m256i *) p, v)
+
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", int8_t,   __m128i, MEDIAN_FILTER_SSE_LOAD_I, MEDIAN_FILTER_SSE_STORE_I, _mm_min_epi8,  _mm_max_epi8)
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", uint8_t,  __m128i, MEDIAN_FILTER_SSE_LOAD_I, MEDIAN_FILTER_SSE_STORE_I, _mm_min_epu8,  _mm_max_epu8)
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", int16_t,  __m128i, MEDIAN_FILTER_SSE_LOAD_I, MEDIAN_FILTER_SSE_STORE_I, _mm_min_epi16, _mm_max_epi16)
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", uint16_t, __m128i, MEDIAN_FILTER_SSE_LOAD_I, MEDIAN_FILTER_SSE_STORE_I, _mm_min_epu16, _mm_max_epu16)
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", int32_t,  __m128i, MEDIAN_FILTER_SSE_LOAD_I, MEDIAN_FILTER_SSE_STORE_I, _mm_min_epi32, _mm_max_epi32)
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", uint32_t, __m128i, MEDIAN_FILTER_SSE_LOAD_I, MEDIAN_FILTER_SSE_STORE_I, _mm_min_epu32, _mm_max_epu32)
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", float,    __m128,  _mm_loadu_ps(p), _mm_storeu_ps(p, v), _mm_min_ps, _mm_max_ps)
+      MEDIAN_FILTER_LANE(Sse41Lane, "sse4.1", double,   __m128d, _mm_loadu_pd(p), _mm_storeu_pd(p, v), _mm_min_pd, _mm_max_pd)
+
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", int8_t,   __m256i, MEDIAN_FILTER_AVX_LOAD_I, MEDIAN_FILTER_AVX_STORE_I, _mm256_min_epi8,  _mm256_max_epi8)
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", uint8_t,  __m256i, MEDIAN_FILTER_AVX_LOAD_I, MEDIAN_FILTER_AVX_STORE_I, _mm256_min_epu8,  _mm256_max_epu8)
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", int16_t,  __m256i, MEDIAN_FILTER_AVX_LOAD_I, MEDIAN_FILTER_AVX_STORE_I, _mm256_min_epi16, _mm256_max_epi16)
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", uint16_t, __m256i, MEDIAN_FILTER_AVX_LOAD_I, MEDIAN_FILTER_AVX_STORE_I, _mm256_min_epu16, _mm256_max_epu16)
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", int32_t,  __m256i, MEDIAN_FILTER_AVX_LOAD_I, MEDIAN_FILTER_AVX_STORE_I, _mm256_min_epi32, _mm256_max_epi32)
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", uint32_t, __m256i, MEDIAN_FILTER_AVX_LOAD_I, MEDIAN_FILTER_AVX_STORE_I, _mm256_min_epu32, _mm256_max_epu32)
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", float,    __m256,  _mm256_loadu_ps(p), _mm256_storeu_ps(p, v), _mm256_min_ps, _mm256_max_ps)
+      MEDIAN_FILTER_LANE(Avx2Lane, "avx2", double,   __m256d, _mm256_loadu_pd(p), _mm256_storeu_pd(p, v), _mm256_min_pd, _mm256_max_pd)
+
+      #undef MEDIAN_FILTER_SSE_LOAD_I
+      #undef MEDIAN_FILTER_SSE_STORE_I
+      #undef MEDIAN_FILTER_AVX_LOAD_I
+      #undef MEDIAN_FILTER_AVX_STORE_I
+      #undef MEDIAN_FILTER_LANE
+
+      #define MEDIAN_FILTER_LANE_CE(i, j) \
+         { const typename Lane::Vector lo = Lane::lower(p[i], p[j]); p[j] = Lane::upper(p[i], p[j]); p[i] = lo; }
+
+      // the column loop is spelled out per instruction set so that it carries the matching target attribute
+      #define MEDIAN_FILTER_LANE_COLUMNS(NAME, LANE, TARGET) \
+         template <typename T, size_t Window> \
+         __attribute__((target(TARGET))) size_t NAME(const T * data, size_t channels, T * medians) \
+         { \
+            typedef LANE<T> Lane; \
+            size_t c = 0; \
+            for(; c + Lane::lanes <= channels; c += Lane::lanes) \
+            { \
+               typename Lane::Vector p[9];   /* sized for the largest network, unused entries fold away */ \
+               for(size_t i = 0; i < Window; i++) p[i] = Lane::load(data + i * channels + c); \
+               switch(Window) \
+               { \
+                  case 3:  MEDIAN_FILTER_NETWORK_3(MEDIAN_FILTER_LANE_CE) break; \
+                  case 5:  MEDIAN_FILTER_NETWORK_5(MEDIAN_FILTER_LANE_CE) break; \
+                  case 7:  MEDIAN_FILTER_NETWORK_7(MEDIAN_FILTER_LANE_CE) break; \
+                  default: MEDIAN_FILTER_NETWORK_9(MEDIAN_FILTER_LANE_CE) break; \
+               } \
+               Lane::store(medians + c, p[Window / 2]); \
+            } \
+            return c; \
+         }
+
+      MEDIAN_FILTER_LANE_COLUMNS(sse41_columns, Sse41Lane, "sse4.1")
+      MEDIAN_FILTER_LANE_COLUMNS(avx2_columns, Avx2Lane, "avx2")
+
+      #undef MEDIAN_FILTER_LANE_COLUMNS
+      #undef MEDIAN_FILTER_LANE_CE
+
+      inline bool cpu_has_avx2()
+      {
+         static const bool avx2 = __builtin_cpu_supports("avx2");
+         return avx2;
+      }
+
+      inline bool cpu_has_sse41()
+      {
+         static const bool sse41 = __builtin_cpu_supports("sse4.1");
+         return sse41;
+      }
+
+      template <size_t Window, typename T>
+      inline size_t simd_columns_for(const T * data, size_t channels, T * medians, bool)   // sample type with lanes
+      {
+         if(cpu_has_avx2())  return avx2_columns<T, Window>(data, channels, medians);
+         if(cpu_has_sse41()) return sse41_columns<T, Window>(data, channels, medians);
+         return 0;
+      }
+
+      template <size_t Window, typename T>
+      inline size_t simd_columns_for(const T *, size_t, T *, int)   // sample type without lanes
+      {
+         return 0;
+      }
+
+      template <typename T>
+      inline size_t simd_columns(const T * data, size_t window, size_t channels, T * medians)
+      {
+         typedef typename conditional<(Avx2Lane<T>::lanes > 0), bool, int>::type Supported;
+
+         switch(window)
+         {
+            case 3:  return simd_columns_for<3>(data, channels, medians, Supported());
+            case 5:  return simd_columns_for<5>(data, channels, medians, Supported());
+            case 7:  return simd_columns_for<7>(data, channels, medians, Supported());
+            default: return simd_columns_for<9>(data, channels, medians, Supported());
+         }
+      }
+
+   #else
+
+      template <typename T>
+      inline size_t simd_columns(const T *, size_t, size_t, T *)
+      {
+         return 0;
+      }
+
+   #endif
+
+      // medians[c] = median of data[i * channels + c] for i < window, window must pass is_network_window()
+      template <typename T>
+      inline void network_medians(const T * data, size_t window, size_t channels, T * medians)
+      {
+         for(size_t c = simd_columns(data, window, channels, medians); c < channels; c++)
+         {
+            medians[c] = network_median(data + c, window, channels);
+         }
+      }
+   }
+
+#endif
@@ -0,0 +1,246 @@
+/*
+  MedianFilterTree.h - Order statistic tree over ring buffer slots, part of the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   SlotTree is a treap whose nodes are the slots of a ring buffer owned by the caller, ordered by the sample stored in each slot.
+   Each slot has a left, right and parent link and a subtree size, kept in one block of 4 * capacity Index entries that the
+   caller allocates.  A slot's heap priority is a fixed hash of its number.  Insert, erase and select of the k-th smallest
+   slot are O(log n) expected.  Replacing a sample is erase(slot), store the new value, insert(slot).
+
+   Used by the tree engine of MedianFilter and by TimedMedianFilter.
+ */
+
+#ifndef MedianFilterTree_h
+
+   #define MedianFilterTree_h
+
+   #include "MedianFilterPlatform.h"
+
+   namespace median_filter_detail
+   {
+      template <typename T, typename Index>
+      struct SlotTree
+      {
+         static const Index nil = limits<Index>::highest();   // never a valid slot, capacity is at most Index max
+
+         Index * links;      // left, right, parent and subtree size blocks, each capacity long
+         Index capacity;
+         Index root;
+
+         void clear() { root = nil; }
+         Index size() const { return (root == nil) ? 0 : links[3 * (size_t) capacity + root]; }
+
+         void insert(const T * data, Index n);
+         void erase(Index n);
+         Index select(Index k) const;
+         Index first() const;
+         Index last() const;
+         Index next(Index n) const;
+
+         static uint32_t priority(Index n);
+         void rotateUp(Index n);
+      };
+
+      template <typename T, typename Index>
+      uint32_t SlotTree<T, Index>::priority(Index n)
+      {
+         // fixed pseudo random heap priority per slot, a slot keeps its priority while its value changes
+         uint32_t x = (uint32_t) n + 0x9E3779B9UL;
+         x ^= x >> 16;
+         x *= 0x7FEB352DUL;
+         x ^= x >> 15;
+         x *= 0x846CA68BUL;
+         x ^= x >> 16;
+         return x;
+      }
+
+      template <typename T, typename Index>
+      void SlotTree<T, Index>::rotateUp(Index n)
+      {
+         Index * left   = links;
+         Index * right  = links + capacity;
+         Index * parent = links + 2 * (size_t) capacity;
+         Index * count  = links + 3 * (size_t) capacity;
+
+         Index p = parent[n];
+         Index g = parent[p];
+
+         if(left[p] == n)  // n moves up, p becomes its right child
+         {
+            left[p] = right[n];
+            if(right[n] != nil) parent[right[n]] = p;
+            right[n] = p;
+         }
+         else              // n moves up, p becomes its left child
+         {
+            right[p] = left[n];
+            if(left[n] != nil) parent[left[n]] = p;
+            left[n] = p;
+         }
+         parent[p] = n;
+         parent[n] = g;
+
+         if(g == nil)          root = n;
+         else if(left[g] == p)     left[g] = n;
+         else                      right[g] = n;
+
+         count[p] = 1 + (left[p] != nil ? count[left[p]] : 0) + (right[p] != nil ? count[right[p]] : 0);
+         count[n] = 1 + (left[n] != nil ? count[left[n]] : 0) + (right[n] != nil ? count[right[n]] : 0);
+      }
+
+      template <typename T, typename Index>
+      void SlotTree<T, Index>::insert(const T * data, Index n)
+      {
+         Index * left   = links;
+         Index * right  = links + capacity;
+         Index * parent = links + 2 * (size_t) capacity;
+         Index * count  = links + 3 * (size_t) capacity;
+
+         left[n]   = nil;
+         right[n]  = nil;
+         parent[n] = nil;
+         count[n]  = 1;
+
+         if(root == nil)
+         {
+            root = n;
+            return;
+         }
+
+         // descend as a leaf, equal values go right so that they stay in age order
+         Index p = root;
+         for(;;)
+         {
+            count[p]++;
+            Index & next = (data[n] < data[p]) ? left[p] : right[p];
+            if(next == nil)
+            {
+               next = n;
+               parent[n] = p;
+               break;
+            }
+            p = next;
+         }
+
+         // restore the heap order of the priorities
+         const uint32_t weight = priority(n);
+         while(parent[n] != nil && priority(parent[n]) < weight)
+         {
+            rotateUp(n);
+         }
+      }
+
+      template <typename T, typename Index>
+      void SlotTree<T, Index>::erase(Index n)
+      {
+         Index * left   = links;
+         Index * right  = links + capacity;
+         Index * parent = links + 2 * (size_t) capacity;
+         Index * count  = links + 3 * (size_t) capacity;
+
+         // rotate n down until it has at most one child
+         while(left[n] != nil && right[n] != nil)
+         {
+            rotateUp(priority(left[n]) > priority(right[n]) ? left[n] : right[n]);
+         }
+
+         Index child = (left[n] != nil) ? left[n] : right[n];
+         Index p = parent[n];
+
+         if(child != nil) parent[child] = p;
+
+         if(p == nil)          root = child;
+         else if(left[p] == n)     left[p] = child;
+         else                      right[p] = child;
+
+         for(; p != nil; p = parent[p])
+         {
+            count[p]--;
+         }
+      }
+
+      template <typename T, typename Index>
+      Index SlotTree<T, Index>::select(Index k) const // slot holding the k-th smallest sample
+      {
+         const Index * left   = links;
+         const Index * right  = links + capacity;
+         const Index * count  = links + 3 * (size_t) capacity;
+
+         Index n = root;
+         for(;;)
+         {
+            Index leftCount = (left[n] != nil) ? count[left[n]] : 0;
+
+            if(k < leftCount)
+            {
+               n = left[n];
+            }
+            else if(k == leftCount)
+            {
+               return n;
+            }
+            else
+            {
+               k -= leftCount + 1;
+               n = right[n];
+            }
+         }
+      }
+
+      template <typename T, typename Index>
+      Index SlotTree<T, Index>::first() const   // slot of the smallest sample
+      {
+         Index n = root;
+         while(links[n] != nil) n = links[n];   // follow left links
+         return n;
+      }
+
+      template <typename T, typename Index>
+      Index SlotTree<T, Index>::last() const   // slot of the largest sample
+      {
+         const Index * right = links + capacity;
+         Index n = root;
+         while(right[n] != nil) n = right[n];
+         return n;
+      }
+
+      template <typename T, typename Index>
+      Index SlotTree<T, Index>::next(Index n) const   // in order successor, nil after the largest sample
+      {
+         const Index * left   = links;
+         const Index * right  = links + capacity;
+         const Index * parent = links + 2 * (size_t) capacity;
+
+         if(right[n] != nil)
+         {
+            n = right[n];
+            while(left[n] != nil) n = left[n];
+            return n;
+         }
+
+         Index p = parent[n];
+         while(p != nil && right[p] == n)
+         {
+            n = p;
+            p = parent[p];
+         }
+         return p;
+      }
+   }
+
+#endif
@@ -0,0 +1,118 @@
+/*
+  StaticMedianFilter.h - Fixed size median filter with inline storage for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   StaticMedianFilter<T, Sum, N> is a MedianFilter<T, Sum> whose window size N is fixed at compile time.
+
+   The ring buffer and both maps are array members (std::array, or a plain array wrapper on Arduino), so the filter never allocates: it can live on the stack, in static
+   pools or by value in containers, and copying it is a plain member copy.  The map index type is the smallest unsigned type
+   that holds N.  All loops run to the constant N, which lets the compiler unroll them.
+
+   The constructor and reset() are constexpr when compiled as C++17 or later.
+
+   For N = 3, 5, 7 and 9 the maps are dropped: in() loads the window into locals and takes the median with a branch free
+   min/max selection network (MedianFilterNetwork.h), and getMin() / getMax() reduce the window the same way.  This avoids the
+   mispredicted early exits of the insertion sort on noisy input.  Results are identical to MedianFilter for integer samples and
+   for floating point samples without NaN.  MedianFilter picks the same networks at run time for these window sizes
+   (MedianFilterEngine::Network).
+ */
+
+#ifndef StaticMedianFilter_h
+
+   #define StaticMedianFilter_h
+
+   #include "MedianFilter.h"
+   #include "MedianFilterNetwork.h"
+
+   namespace median_filter_detail
+   {
+      // smallest unsigned type able to index a window of N samples
+      template <size_t N>
+      struct index_for
+      {
+         typedef typename conditional<(N <= 0xFFUL), uint8_t,
+                 typename conditional<(N <= 0xFFFFUL), uint16_t, uint32_t>::type>::type type;
+      };
+   }
+
+   template <typename T, typename Sum, size_t N>
+   class StaticMedianFilter
+   {
+      static_assert(N >= 3, "the window needs at least 3 samples");
+      static_assert(N <= 0xFFFFFFFFUL, "the window is limited to 2^32 - 1 samples");
+
+      public:
+         typedef typename median_filter_detail::index_for<N>::type Index;
+
+         MEDIAN_FILTER_CONSTEXPR explicit StaticMedianFilter(T seed = T());
+
+         T in(const T & value);
+         void in(const T * src, T * dst, size_t n);   // filter a buffer, dst[i] is what in(src[i]) would return; dst may equal src
+         T out() const;
+
+         T getMin() const;
+         T getMax() const;
+         Sum getMean() const;
+         Sum getStdDev() const;
+         Sum getMAD() const;                      // median absolute deviation, median of |sample - out()|
+
+         T getRank(size_t k) const;              // k-th smallest sample, 0 is getMin(), N - 1 is getMax()
+         Sum getQuantile(double p) const;         // p in [0, 1], linear interpolation between ranks
+         void getQuantiles(const double * p, Sum * quantiles, size_t count) const;
+
+         MEDIAN_FILTER_CONSTEXPR void reset(T seed);
+
+         void setStdDevResync(uint32_t updates);   // re-sum the variance exactly every `updates` samples, 0 = never
+
+         static constexpr size_t size() { return N; }
+
+      private:
+         static constexpr Index medDataPointer = N >> 1;   // mid point of window
+         static constexpr bool network = (N == 3 || N == 5 || N == 7 || N == 9);   // selection network instead of maps
+         static constexpr size_t mapSize = network ? 0 : N;
+
+         typedef median_filter_detail::integral_constant<bool, true> NetworkPath;
+         typedef median_filter_detail::integral_constant<bool, false> MapPath;
+         typedef median_filter_detail::integral_constant<bool, network> Path;
+
+         median_filter_detail::array<T, N> data {};                    // samples by age in ring buffer
+         median_filter_detail::array<Index, mapSize> sizeMap {};       // locations of data sorted by size
+         median_filter_detail::array<Index, mapSize> locationMap {};   // locations of data in the size map, by age
+         Index oldestDataPoint {};                    // oldest data point location in ring buffer
+         Sum totalSum {};
+         median_filter_detail::RunningVariance runningVariance {};
+
+         MEDIAN_FILTER_CONSTEXPR void resetMaps(MapPath);
+         MEDIAN_FILTER_CONSTEXPR void resetMaps(NetworkPath) {}
+         void update(MapPath);
+         void update(NetworkPath) {}
+         T median(MapPath) const;
+         T median(NetworkPath) const;
+         T smallest(MapPath) const;
+         T smallest(NetworkPath) const;
+         T largest(MapPath) const;
+         T largest(NetworkPath) const;
+         T rank(size_t k, MapPath) const;
+         T rank(size_t k, NetworkPath) const;
+         Sum mad(MapPath) const;
+         Sum mad(NetworkPath) const;
+   };
+
+#include "StaticMedianFilter.hpp"
+
+#endif
@@ -0,0 +1,240 @@
+/*
+   StaticMedianFilter.hpp - Fixed size median filter with inline storage for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "StaticMedianFilter.h"
+
+template <typename T, typename Sum, size_t N>
+constexpr typename StaticMedianFilter<T, Sum, N>::Index StaticMedianFilter<T, Sum, N>::medDataPointer;
+
+template <typename T, typename Sum, size_t N>
+constexpr bool StaticMedianFilter<T, Sum, N>::network;
+
+template <typename T, typename Sum, size_t N>
+constexpr size_t StaticMedianFilter<T, Sum, N>::mapSize;
+
+template <typename T, typename Sum, size_t N>
+MEDIAN_FILTER_CONSTEXPR StaticMedianFilter<T, Sum, N>::StaticMedianFilter(T seed)
+{
+   reset(seed);
+}
+
+template <typename T, typename Sum, size_t N>
+MEDIAN_FILTER_CONSTEXPR void StaticMedianFilter<T, Sum, N>::reset(T seed)
+{
+   oldestDataPoint = medDataPointer;      // oldest data point location in data array
+   totalSum        = N * ((Sum) seed);    // total of all values
+   runningVariance.reset(seed, N);
+
+   for(size_t i = 0; i < N; i++)
+   {
+      data[i] = seed;   // populate with seed value
+   }
+
+   resetMaps(Path());
+}
+
+template <typename T, typename Sum, size_t N>
+MEDIAN_FILTER_CONSTEXPR void StaticMedianFilter<T, Sum, N>::resetMaps(MapPath)
+{
+   for(size_t i = 0; i < N; i++)
+   {
+      sizeMap[i]     = (Index) i;   // start map with straight run
+      locationMap[i] = (Index) i;   // start map with straight run
+   }
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::in(const T & value)
+{
+   const T old = data[oldestDataPoint];
+
+   if (median_filter_detail::is_valid_value(value)) {
+      totalSum += ((Sum) value) - old;  // add new value and remove oldest value
+   }
+
+   data[oldestDataPoint] = value;  // store new data in location of oldest data in ring buffer
+   update(Path());
+   runningVariance.update(old, value, data.data(), N);
+
+   oldestDataPoint++;       // increment and wrap
+   if(oldestDataPoint == N) oldestDataPoint = 0;
+
+   return out();
+}
+
+template <typename T, typename Sum, size_t N>
+void StaticMedianFilter<T, Sum, N>::in(const T * src, T * dst, size_t n)
+{
+   for(size_t i = 0; i < n; i++)
+   {
+      dst[i] = in(src[i]);
+   }
+}
+
+template <typename T, typename Sum, size_t N>
+void StaticMedianFilter<T, Sum, N>::update(MapPath)
+{
+   median_filter_detail::sorted_update(data.data(), sizeMap.data(), locationMap.data(), (Index) N, oldestDataPoint);
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::out() const // return the value of the median data sample
+{
+   return median(Path());
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::median(MapPath) const
+{
+   return data[sizeMap[medDataPointer]];
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::median(NetworkPath) const
+{
+   T p[N];   // the whole window in registers
+   for(size_t i = 0; i < N; i++)
+   {
+      p[i] = data[i];
+   }
+   return median_filter_detail::NetworkMedian<N, T>::run(p);
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::getMin() const
+{
+   return smallest(Path());
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::smallest(MapPath) const
+{
+   return data[sizeMap[0]];
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::smallest(NetworkPath) const
+{
+   T result = data[0];
+   for(size_t i = 1; i < N; i++)
+   {
+      result = median_filter_detail::network_min(result, data[i]);
+   }
+   return result;
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::getMax() const
+{
+   return largest(Path());
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::largest(MapPath) const
+{
+   return data[sizeMap[N - 1]];
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::largest(NetworkPath) const
+{
+   T result = data[0];
+   for(size_t i = 1; i < N; i++)
+   {
+      result = median_filter_detail::network_max(result, data[i]);
+   }
+   return result;
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::getRank(size_t k) const
+{
+   if(k >= N) k = N - 1;
+   return rank(k, Path());
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::rank(size_t k, MapPath) const
+{
+   return data[sizeMap[k]];
+}
+
+template <typename T, typename Sum, size_t N>
+T StaticMedianFilter<T, Sum, N>::rank(size_t k, NetworkPath) const
+{
+   T p[N];
+   median_filter_detail::sorted_copy(data.data(), N, p);   // no maps, sort a copy of the (at most 9 sample) window
+   return p[k];
+}
+
+template <typename T, typename Sum, size_t N>
+Sum StaticMedianFilter<T, Sum, N>::getMAD() const
+{
+   return mad(Path());
+}
+
+template <typename T, typename Sum, size_t N>
+Sum StaticMedianFilter<T, Sum, N>::mad(MapPath) const
+{
+   return median_filter_detail::median_absolute_deviation<Sum>([this](size_t k) { return data[sizeMap[k]]; }, N);
+}
+
+template <typename T, typename Sum, size_t N>
+Sum StaticMedianFilter<T, Sum, N>::mad(NetworkPath) const
+{
+   T p[N];
+   median_filter_detail::sorted_copy(data.data(), N, p);
+   return median_filter_detail::median_absolute_deviation<Sum>([&p](size_t k) { return p[k]; }, N);
+}
+
+template <typename T, typename Sum, size_t N>
+Sum StaticMedianFilter<T, Sum, N>::getQuantile(double p) const
+{
+   const median_filter_detail::QuantilePosition q(p, N);
+
+   if(q.fraction == 0.0) return (Sum) getRank(q.rank);
+   return median_filter_detail::interpolate<Sum>(getRank(q.rank), getRank(q.rank + 1), q.fraction);
+}
+
+template <typename T, typename Sum, size_t N>
+void StaticMedianFilter<T, Sum, N>::getQuantiles(const double * p, Sum * quantiles, size_t count) const
+{
+   for(size_t i = 0; i < count; i++)
+   {
+      quantiles[i] = getQuantile(p[i]);
+   }
+}
+
+template <typename T, typename Sum, size_t N>
+Sum StaticMedianFilter<T, Sum, N>::getMean() const
+{
+   return totalSum / (Sum) N;
+}
+
+template <typename T, typename Sum, size_t N>
+Sum StaticMedianFilter<T, Sum, N>::getStdDev() const // O(1), the variance is maintained by in()
+{
+   return Sum( median_filter_detail::square_root( runningVariance.variance(N) + 0.5 ) );
+}
+
+template <typename T, typename Sum, size_t N>
+void StaticMedianFilter<T, Sum, N>::setStdDevResync(uint32_t updates)
+{
+   runningVariance.resyncInterval = updates;
+   runningVariance.sinceResync = 0;
+}
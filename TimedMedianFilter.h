@@ -0,0 +1,96 @@
+/*
+  TimedMedianFilter.h - Median filter over a time horizon for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   A TimedMedianFilter keeps every sample younger than a time horizon instead of a fixed number of samples, e.g. the median
+   of the last 500 ms of a channel that arrives at an irregular rate:
+
+      TimedMedianFilter<int, long> filter(500, 64);   // 500 time units, at most 64 samples
+      int median = filter.in(value, millis());
+
+   in(value, timestamp) first evicts every sample whose age timestamp - t is at least the horizon, then stores the new sample.
+   evict(now) drops expired samples without adding one, so a silent channel still ages out.  Timestamps must not decrease;
+   they are compared as unsigned differences, so millis() / micros() wrap around safely.  When more than capacity samples are
+   younger than the horizon the oldest one is dropped early.
+
+   Samples sit in a ring buffer of capacity slots, ordered by an order statistic tree over those slots (MedianFilterTree.h).
+   Each sample is inserted and evicted once, O(log capacity) each, and every order statistic query is O(log capacity).
+   The median of an even number of samples is the upper one of the middle pair, like MedianFilter.  An empty filter returns T().
+ */
+
+#ifndef TimedMedianFilter_h
+
+   #define TimedMedianFilter_h
+
+   #include "MedianFilter.h"
+   #include "MedianFilterTree.h"
+
+   template <typename T, typename Sum, typename Time = uint32_t, typename Index = uint16_t>
+   class TimedMedianFilter
+   {
+      static_assert(median_filter_detail::limits<Index>::is_integer && !median_filter_detail::limits<Index>::is_signed, "Index must be an unsigned integer type");
+      static_assert(median_filter_detail::limits<Time>::is_integer && !median_filter_detail::limits<Time>::is_signed, "Time must be an unsigned integer type");
+
+      public:
+         TimedMedianFilter(Time horizon, size_t capacity);
+         TimedMedianFilter(const TimedMedianFilter<T, Sum, Time, Index> &other);
+         TimedMedianFilter(TimedMedianFilter<T, Sum, Time, Index> &&other);
+         ~TimedMedianFilter();
+
+         T in(const T & value, Time timestamp);   // evict samples older than the horizon, add value, return the median
+         void evict(Time now);                    // evict samples older than the horizon without adding one
+         T out() const;
+
+         T getMin() const;
+         T getMax() const;
+         Sum getMean() const;
+
+         T getRank(size_t k) const;              // k-th smallest sample, 0 is getMin(), count() - 1 is getMax()
+         Sum getQuantile(double p) const;         // p in [0, 1], linear interpolation between ranks
+         void getQuantiles(const double * p, Sum * quantiles, size_t count) const;
+
+         size_t count() const;                    // samples currently in the window
+         size_t capacity() const;
+         Time getHorizon() const;
+         void setHorizon(Time horizon);           // takes effect at the next in() or evict()
+
+         void reset();
+
+         TimedMedianFilter<T, Sum, Time, Index>& operator=(const TimedMedianFilter<T, Sum, Time, Index>&);
+         TimedMedianFilter<T, Sum, Time, Index>& operator=(TimedMedianFilter<T, Sum, Time, Index>&&);
+
+      private:
+         Time horizon;            // samples at least this old are evicted
+         Index slots;             // ring buffer capacity
+         Index oldestDataPoint;   // oldest data point location in ring buffer
+         Index occupancy;         // samples in the window, stored from oldestDataPoint on
+         T * data;                // array pointer for data sorted by age in ring buffer
+         Time * timestamps;       // array pointer for the timestamp of each ring buffer slot
+         Sum totalSum;            // sum of the valid samples in the window
+         Index validCount;        // samples included in totalSum
+         median_filter_detail::SlotTree<T, Index> tree;
+
+         void allocate();
+         void release();
+         void copyFrom(const TimedMedianFilter<T, Sum, Time, Index> &other);
+         void popOldest();
+   };
+
+#include "TimedMedianFilter.hpp"
+
+#endif
@@ -0,0 +1,263 @@
+/*
+   TimedMedianFilter.hpp - Median filter over a time horizon for the MedianFilter library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TimedMedianFilter.h"
+
+template <typename T, typename Sum, typename Time, typename Index>
+TimedMedianFilter<T, Sum, Time, Index>::TimedMedianFilter(Time horizon, size_t capacity) :
+   horizon { horizon }
+{
+   slots = median_filter_detail::clamp(capacity, (size_t) 1, (size_t) median_filter_detail::limits<Index>::highest());   // Index max is the tree's nil
+
+   allocate();
+   reset();
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+TimedMedianFilter<T, Sum, Time, Index>::TimedMedianFilter(const TimedMedianFilter<T, Sum, Time, Index> &other) :
+   horizon { other.horizon },
+   slots { other.slots } {
+   allocate();
+   copyFrom(other);
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+TimedMedianFilter<T, Sum, Time, Index>& TimedMedianFilter<T, Sum, Time, Index>::operator=(const TimedMedianFilter<T, Sum, Time, Index>& other) {
+   if(this == &other) return *this;
+
+   release();
+   horizon = other.horizon;
+   slots = other.slots;
+   allocate();
+   copyFrom(other);
+
+   return *this;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+TimedMedianFilter<T, Sum, Time, Index>::TimedMedianFilter(TimedMedianFilter<T, Sum, Time, Index> &&other) :
+   horizon { other.horizon },
+   slots { other.slots },
+   oldestDataPoint { other.oldestDataPoint },
+   occupancy { other.occupancy },
+   data { other.data },
+   timestamps { other.timestamps },
+   totalSum { other.totalSum },
+   validCount { other.validCount },
+   tree ( other.tree ) {
+   other.data = nullptr;
+   other.timestamps = nullptr;
+   other.tree.links = nullptr;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+TimedMedianFilter<T, Sum, Time, Index>& TimedMedianFilter<T, Sum, Time, Index>::operator=(TimedMedianFilter<T, Sum, Time, Index>&& other) {
+   if(this == &other) return *this;
+
+   release();
+   horizon = other.horizon;
+   slots = other.slots;
+   oldestDataPoint = other.oldestDataPoint;
+   occupancy = other.occupancy;
+   data = other.data;
+   timestamps = other.timestamps;
+   totalSum = other.totalSum;
+   validCount = other.validCount;
+   tree = other.tree;
+   other.data = nullptr;
+   other.timestamps = nullptr;
+   other.tree.links = nullptr;
+   return *this;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+TimedMedianFilter<T, Sum, Time, Index>::~TimedMedianFilter()
+{
+   release();
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::allocate()
+{
+   data          = (T*) calloc (slots, sizeof(T));                            // array for data
+   timestamps    = (Time*) calloc (slots, sizeof(Time));                      // array for the timestamp of every slot
+   tree.links    = (Index*) calloc (4 * (size_t) slots, sizeof(Index));       // left, right, parent and subtree size of every slot
+   tree.capacity = slots;
+   tree.root     = tree.nil;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::release()
+{
+   free(data);
+   free(timestamps);
+   free(tree.links);
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::copyFrom(const TimedMedianFilter<T, Sum, Time, Index> &other)
+{
+   oldestDataPoint = other.oldestDataPoint;
+   occupancy = other.occupancy;
+   totalSum = other.totalSum;
+   validCount = other.validCount;
+   tree.root = other.tree.root;
+   memcpy(data, other.data, slots * sizeof(T));
+   memcpy(timestamps, other.timestamps, slots * sizeof(Time));
+   memcpy(tree.links, other.tree.links, 4 * (size_t) slots * sizeof(Index));
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::popOldest()
+{
+   const T & old = data[oldestDataPoint];
+   if(median_filter_detail::is_valid_value(old))
+   {
+      totalSum -= (Sum) old;
+      validCount--;
+   }
+
+   tree.erase(oldestDataPoint);
+   oldestDataPoint++;
+   if(oldestDataPoint >= slots) oldestDataPoint = 0;
+   occupancy--;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::evict(Time now)
+{
+   // unsigned difference, correct across a wrap of the time counter
+   while(occupancy > 0 && (Time) (now - timestamps[oldestDataPoint]) >= horizon)
+   {
+      popOldest();
+   }
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+T TimedMedianFilter<T, Sum, Time, Index>::in(const T & value, Time timestamp)
+{
+   evict(timestamp);
+   if(occupancy == slots) popOldest();   // more samples within the horizon than slots, drop the oldest early
+
+   size_t slot = (size_t) oldestDataPoint + occupancy;
+   if(slot >= slots) slot -= slots;
+
+   data[slot] = value;
+   timestamps[slot] = timestamp;
+   tree.insert(data, (Index) slot);
+   occupancy++;
+
+   if(median_filter_detail::is_valid_value(value))
+   {
+      totalSum += (Sum) value;
+      validCount++;
+   }
+
+   return out();
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+T TimedMedianFilter<T, Sum, Time, Index>::out() const // return the value of the median data sample
+{
+   if(occupancy == 0) return T();
+   return data[tree.select(occupancy >> 1)];
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+T TimedMedianFilter<T, Sum, Time, Index>::getMin() const
+{
+   if(occupancy == 0) return T();
+   return data[tree.first()];
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+T TimedMedianFilter<T, Sum, Time, Index>::getMax() const
+{
+   if(occupancy == 0) return T();
+   return data[tree.last()];
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+Sum TimedMedianFilter<T, Sum, Time, Index>::getMean() const
+{
+   if(validCount == 0) return Sum();
+   return totalSum / (Sum) validCount;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+T TimedMedianFilter<T, Sum, Time, Index>::getRank(size_t k) const
+{
+   if(occupancy == 0) return T();
+   if(k >= occupancy) k = occupancy - 1;
+
+   return data[tree.select((Index) k)];
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+Sum TimedMedianFilter<T, Sum, Time, Index>::getQuantile(double p) const
+{
+   if(occupancy == 0) return Sum();
+
+   const median_filter_detail::QuantilePosition q(p, occupancy);
+
+   if(q.fraction == 0.0) return (Sum) getRank(q.rank);
+   return median_filter_detail::interpolate<Sum>(getRank(q.rank), getRank(q.rank + 1), q.fraction);
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::getQuantiles(const double * p, Sum * quantiles, size_t count) const
+{
+   for(size_t i = 0; i < count; i++)
+   {
+      quantiles[i] = getQuantile(p[i]);
+   }
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+size_t TimedMedianFilter<T, Sum, Time, Index>::count() const
+{
+   return occupancy;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+size_t TimedMedianFilter<T, Sum, Time, Index>::capacity() const
+{
+   return slots;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+Time TimedMedianFilter<T, Sum, Time, Index>::getHorizon() const
+{
+   return horizon;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::setHorizon(Time horizon)
+{
+   this->horizon = horizon;
+}
+
+template <typename T, typename Sum, typename Time, typename Index>
+void TimedMedianFilter<T, Sum, Time, Index>::reset()
+{
+   oldestDataPoint = 0;
+   occupancy       = 0;
+   totalSum        = 0;
+   validCount      = 0;
+   tree.clear();
+}
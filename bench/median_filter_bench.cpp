@@ -0,0 +1,468 @@
+/*
+  median_filter_bench.cpp - Microbenchmarks for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   Times MedianFilter operations over window sizes, sample types and input distributions:
+
+      in         - one sample through in(), the filter primed with a full window first
+      out        - out() on a full window
+      stddev     - getStdDev() on a full window
+      copy       - copy construction of a full filter
+      move       - move construction of a full filter
+      hop        - one sample through HoppingMedianFilter with a median every MEDIAN_BENCH_HOP samples
+      tumble     - one sample through HoppingMedianFilter with a median once per window (hop == window)
+      lazyN      - one sample through LazyMedianFilter with out() after every N samples, N = 1, 16, 256, 4096; compare with in
+      network    - one sample through in() with MedianFilterEngine::Sorted and ::Network, windows of 3, 5, 7 and 9, random and
+                   ramp (monotone) input
+      layout     - one sample through in() with MedianFilterEngine::Sorted and ::Interleaved, windows of 3 to 4095, random input
+
+   Engine comparisons are named operation/type/input/window/engine, every other case operation/type/input/window.
+
+   Inputs are generated from a fixed seed, so every run sees the same samples.  Each case is timed MEDIAN_BENCH_REPEATS
+   times and the fastest run is reported, in nanoseconds per sample or per call.
+
+   Usage: median_filter_bench [--json <file>] [--quick] [--filter <substring>]
+      --json    also write the results as JSON to <file>, "-" for stdout (the table then goes to stderr)
+      --quick   smaller windows and sample counts, for smoke runs
+      --filter  only run cases whose name contains <substring>, e.g. "in/int16"
+ */
+
+#include <MedianFilter.h>
+#include <HoppingMedianFilter.h>
+#include <LazyMedianFilter.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef MEDIAN_BENCH_REPEATS
+   #define MEDIAN_BENCH_REPEATS 5
+#endif
+
+#ifndef MEDIAN_BENCH_HOP
+   #define MEDIAN_BENCH_HOP 64
+#endif
+
+namespace
+{
+   struct Result
+   {
+      std::string name;        // operation/type/input/window
+      std::string operation;
+      std::string type;
+      std::string input;
+      size_t window;
+      std::string engine;
+      double nanoseconds;      // per sample or per call
+   };
+
+   struct Options
+   {
+      const char * jsonPath = nullptr;
+      const char * filter = nullptr;
+      bool quick = false;
+   };
+
+   volatile double sink;   // keeps benchmark results observable
+
+   enum class Input
+   {
+      Random,
+      Ramp,
+      Step,
+      NaN
+   };
+
+   const char * input_name(Input input)
+   {
+      switch(input)
+      {
+         case Input::Random: return "random";
+         case Input::Ramp:   return "ramp";
+         case Input::Step:   return "step";
+         default:            return "nan";
+      }
+   }
+
+   const char * engine_name(MedianFilterEngine engine)
+   {
+      switch(engine)
+      {
+         case MedianFilterEngine::Sorted:      return "sorted";
+         case MedianFilterEngine::Tree:        return "tree";
+         case MedianFilterEngine::Histogram:   return "histogram";
+         case MedianFilterEngine::Interleaved: return "interleaved";
+         case MedianFilterEngine::Network:     return "network";
+         default:                              return "auto";
+      }
+   }
+
+   template <typename T> const char * type_name();
+   template <> const char * type_name<int16_t>() { return "int16"; }
+   template <> const char * type_name<int32_t>() { return "int32"; }
+   template <> const char * type_name<float>()   { return "float"; }
+   template <> const char * type_name<double>()  { return "double"; }
+
+   template <typename T> struct sum_for         { typedef T type; };
+   template <> struct sum_for<int16_t>          { typedef int32_t type; };
+   template <> struct sum_for<int32_t>          { typedef int64_t type; };
+   template <> struct sum_for<float>            { typedef double type; };
+
+   // samples in [-10000, 10000]: uniform noise, a sawtooth of slow ramps, a square wave of steps plus noise, or noise with 1 % NaN
+   template <typename T>
+   std::vector<T> make_input(Input input, size_t n, size_t window)
+   {
+      std::mt19937 random(12345);
+      std::uniform_int_distribution<int> noise(-10000, 10000);
+      std::vector<T> samples(n);
+
+      for(size_t i = 0; i < n; i++)
+      {
+         switch(input)
+         {
+            case Input::Random:
+               samples[i] = (T) noise(random);
+               break;
+            case Input::Ramp:
+               samples[i] = (T) ((int) (i % 20001) - 10000);
+               break;
+            case Input::Step:
+               samples[i] = (T) ((((i / (4 * window + 1)) & 1) ? 5000 : -5000) + noise(random) / 100);
+               break;
+            case Input::NaN:
+               samples[i] = (random() % 100 == 0) ? (T) NAN : (T) noise(random);
+               break;
+         }
+      }
+      return samples;
+   }
+
+   template <typename Operation>
+   double best_of(size_t operations, Operation operation)
+   {
+      double best = 0;
+      for(int r = 0; r < MEDIAN_BENCH_REPEATS; r++)
+      {
+         const auto start = std::chrono::steady_clock::now();
+         operation();
+         const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+         if(r == 0 || ns < best) best = ns;
+      }
+      return best;
+   }
+
+   class Runner
+   {
+      public:
+         explicit Runner(const Options & options) : options(options) {}
+
+         template <typename T>
+         void run(Input input, size_t window);
+
+         template <typename T>
+         void compare(const char * operation, Input input, size_t window, const MedianFilterEngine * engines, size_t count);
+
+         const std::vector<Result> & results() const { return all; }
+
+      private:
+         const Options & options;
+         std::vector<Result> all;
+
+         bool selected(const std::string & name) const
+         {
+            return !options.filter || name.find(options.filter) != std::string::npos;
+         }
+
+         void report(const char * operation, const char * type, Input input, size_t window, MedianFilterEngine engine, double ns)
+         {
+            report(operation, type, input, window, engine_name(engine), ns);
+         }
+
+         void report(const char * operation, const char * type, Input input, size_t window, const char * engine, double ns, bool named = false)
+         {
+            Result r;
+            r.operation = operation;
+            r.type = type;
+            r.input = input_name(input);
+            r.window = window;
+            r.engine = engine;
+            r.name = r.operation + "/" + r.type + "/" + r.input + "/" + std::to_string(window);
+            if(named) r.name += "/" + r.engine;   // engine comparisons time one case per engine
+            r.nanoseconds = ns;
+            all.push_back(r);
+
+            FILE * table = (options.jsonPath && !strcmp(options.jsonPath, "-")) ? stderr : stdout;   // keep stdout valid JSON
+            fprintf(table, "%-40s %-12s %12.2f ns\n", r.name.c_str(), r.engine.c_str(), ns);
+            fflush(table);
+         }
+   };
+
+   template <typename T>
+   void Runner::run(Input input, size_t window)
+   {
+      typedef typename sum_for<T>::type Sum;
+      typedef MedianFilter<T, Sum, uint16_t> Filter;
+
+      const std::string suffix = std::string("/") + type_name<T>() + "/" + input_name(input) + "/" + std::to_string(window);
+
+      // enough samples for a stable time, fewer for the wide windows where every sample costs more
+      size_t samples = options.quick ? 20000 : 200000;
+      if(window >= 4096) samples /= 4;
+
+      const std::vector<T> primer = make_input<T>(input, window, window);
+      const std::vector<T> stream = make_input<T>(input, samples + window, window);
+
+      Filter filter(window, T(0));
+      for(const T & v : primer) filter.in(v);
+      const MedianFilterEngine engine = filter.getEngine();
+
+      if(selected("in" + suffix))
+      {
+         double ns = best_of(samples, [&]() {
+            Filter f(filter);
+            double total = 0;
+            for(size_t i = 0; i < samples; i++) total += (double) f.in(stream[i]);
+            sink = total;
+         });
+         report("in", type_name<T>(), input, window, engine, ns);
+      }
+
+      const size_t hops[] = { MEDIAN_BENCH_HOP, window };
+      const char * hopOperations[] = { "hop", "tumble" };
+
+      for(int h = 0; h < 2; h++)
+      {
+         if(!selected(hopOperations[h] + suffix)) continue;
+
+         HoppingMedianFilter<T, Sum> hopping(window, hops[h], T(0));
+         for(const T & v : primer) hopping.in(v);
+
+         double ns = best_of(samples, [&]() {
+            HoppingMedianFilter<T, Sum> f(hopping);
+            double total = 0;
+            for(size_t i = 0; i < samples; i++)
+            {
+               if(f.in(stream[i])) total += (double) f.out();
+            }
+            sink = total;
+         });
+         report(hopOperations[h], type_name<T>(), input, window, hops[h] < window ? "merge" : "select", ns);
+      }
+
+      const size_t queryEvery[] = { 1, 16, 256, 4096 };
+
+      for(size_t every : queryEvery)
+      {
+         const std::string operation = "lazy" + std::to_string(every);
+         if(!selected(operation + suffix)) continue;
+
+         LazyMedianFilter<T, Sum, uint16_t> lazy(window, T(0));
+         for(const T & v : primer) lazy.in(v);
+
+         double ns = best_of(samples, [&]() {
+            LazyMedianFilter<T, Sum, uint16_t> f(lazy);
+            double total = 0;
+            for(size_t i = 0; i < samples; i++)
+            {
+               f.in(stream[i]);
+               if((i + 1) % every == 0) total += (double) f.out();
+            }
+            sink = total;
+         });
+         report(operation.c_str(), type_name<T>(), input, window, "lazy", ns);
+      }
+
+      for(size_t i = 0; i < window; i++) filter.in(stream[i]);   // a full window of the stream for the queries
+
+      const size_t queries = options.quick ? 100000 : 1000000;
+
+      if(selected("out" + suffix))
+      {
+         double ns = best_of(queries, [&]() {
+            double total = 0;
+            for(size_t i = 0; i < queries; i++) total += (double) filter.out();
+            sink = total;
+         });
+         report("out", type_name<T>(), input, window, engine, ns);
+      }
+
+      if(selected("stddev" + suffix))
+      {
+         double ns = best_of(queries, [&]() {
+            double total = 0;
+            for(size_t i = 0; i < queries; i++) total += (double) filter.getStdDev();
+            sink = total;
+         });
+         report("stddev", type_name<T>(), input, window, engine, ns);
+      }
+
+      size_t copies = (options.quick ? 2000000 : 20000000) / (window + 64);
+      if(copies < 10) copies = 10;
+
+      if(selected("copy" + suffix))
+      {
+         double ns = best_of(copies, [&]() {
+            double total = 0;
+            for(size_t i = 0; i < copies; i++)
+            {
+               Filter copy(filter);
+               total += (double) copy.out();
+            }
+            sink = total;
+         });
+         report("copy", type_name<T>(), input, window, engine, ns);
+      }
+
+      if(selected("move" + suffix))
+      {
+         double ns = best_of(copies, [&]() {
+            double total = 0;
+            for(size_t i = 0; i < copies; i++)
+            {
+               Filter moved(std::move(filter));
+               total += (double) moved.out();
+               filter = std::move(moved);
+            }
+            sink = total;
+         });
+         report("move", type_name<T>(), input, window, engine, ns);
+      }
+   }
+
+   // in() with each of the given engines on the same input
+   template <typename T>
+   void Runner::compare(const char * operation, Input input, size_t window, const MedianFilterEngine * engines, size_t count)
+   {
+      typedef typename sum_for<T>::type Sum;
+      typedef MedianFilter<T, Sum, uint16_t> Filter;
+
+      size_t samples = options.quick ? 20000 : 200000;
+      if(window >= 256) samples = samples * 256 / window;   // the O(window) engines, keep every case within a second
+
+      const std::vector<T> primer = make_input<T>(input, window, window);
+      const std::vector<T> stream = make_input<T>(input, samples, window);
+
+      for(size_t e = 0; e < count; e++)
+      {
+         Filter filter(window, T(0), engines[e]);
+         const std::string name = std::string(operation) + "/" + type_name<T>() + "/" + input_name(input) + "/" +
+                                  std::to_string(window) + "/" + engine_name(filter.getEngine());
+         if(!selected(name)) continue;
+
+         for(const T & v : primer) filter.in(v);
+
+         double ns = best_of(samples, [&]() {
+            Filter f(filter);
+            double total = 0;
+            for(size_t i = 0; i < samples; i++) total += (double) f.in(stream[i]);
+            sink = total;
+         });
+         report(operation, type_name<T>(), input, window, engine_name(filter.getEngine()), ns, true);
+      }
+   }
+
+   void write_json(FILE * file, const std::vector<Result> & results, const Options & options)
+   {
+      fprintf(file, "{\n  \"context\": {\"library\": \"MedianFilter\", \"repeats\": %d, \"quick\": %s, \"unit\": \"ns\"},\n",
+              MEDIAN_BENCH_REPEATS, options.quick ? "true" : "false");
+      fprintf(file, "  \"benchmarks\": [\n");
+      for(size_t i = 0; i < results.size(); i++)
+      {
+         const Result & r = results[i];
+         fprintf(file, "    {\"name\": \"%s\", \"operation\": \"%s\", \"type\": \"%s\", \"input\": \"%s\", \"window\": %zu, \"engine\": \"%s\", \"ns_per_op\": %.3f}%s\n",
+                 r.name.c_str(), r.operation.c_str(), r.type.c_str(), r.input.c_str(), r.window, r.engine.c_str(), r.nanoseconds,
+                 (i + 1 < results.size()) ? "," : "");
+      }
+      fprintf(file, "  ]\n}\n");
+   }
+
+   template <typename T>
+   void run_type(Runner & runner, const std::vector<size_t> & windows, const std::vector<size_t> & layoutWindows, bool floating)
+   {
+      for(size_t window : windows)
+      {
+         runner.run<T>(Input::Random, window);
+         runner.run<T>(Input::Ramp, window);
+         runner.run<T>(Input::Step, window);
+         if(floating) runner.run<T>(Input::NaN, window);
+      }
+
+      // the selection networks against the insertion path, on noisy and on monotone input
+      const MedianFilterEngine networkEngines[] = { MedianFilterEngine::Sorted, MedianFilterEngine::Network };
+      for(size_t window : { 3, 5, 7, 9 })
+      {
+         runner.compare<T>("network", Input::Random, window, networkEngines, 2);
+         runner.compare<T>("network", Input::Ramp, window, networkEngines, 2);
+      }
+
+      // the sorted map against the interleaved records
+      const MedianFilterEngine layoutEngines[] = { MedianFilterEngine::Sorted, MedianFilterEngine::Interleaved };
+      for(size_t window : layoutWindows)
+      {
+         runner.compare<T>("layout", Input::Random, window, layoutEngines, 2);
+      }
+   }
+}
+
+int main(int argc, char ** argv)
+{
+   Options options;
+
+   for(int i = 1; i < argc; i++)
+   {
+      if(!strcmp(argv[i], "--json") && i + 1 < argc)        options.jsonPath = argv[++i];
+      else if(!strcmp(argv[i], "--filter") && i + 1 < argc) options.filter = argv[++i];
+      else if(!strcmp(argv[i], "--quick"))                  options.quick = true;
+      else
+      {
+         fprintf(stderr, "usage: %s [--json <file>] [--quick] [--filter <substring>]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   const std::vector<size_t> windows = options.quick ? std::vector<size_t> { 3, 31, 255, 1023 }
+                                                     : std::vector<size_t> { 3, 7, 31, 255, 1023, 4095, 16383, 65535 };
+
+   const std::vector<size_t> layoutWindows = options.quick ? std::vector<size_t> { 3, 31, 255, 4095 }
+                                                           : std::vector<size_t> { 3, 7, 15, 31, 63, 127, 255, 511, 1023, 2047, 4095 };
+
+   Runner runner(options);
+   run_type<int16_t>(runner, windows, layoutWindows, false);
+   run_type<int32_t>(runner, windows, layoutWindows, false);
+   run_type<float>(runner, windows, layoutWindows, true);
+   run_type<double>(runner, windows, layoutWindows, true);
+
+   if(options.jsonPath)
+   {
+      FILE * file = strcmp(options.jsonPath, "-") ? fopen(options.jsonPath, "w") : stdout;
+      if(!file)
+      {
+         fprintf(stderr, "cannot write %s\n", options.jsonPath);
+         return 1;
+      }
+      write_json(file, runner.results(), options);
+      if(file != stdout) fclose(file);
+   }
+
+   return 0;
+}
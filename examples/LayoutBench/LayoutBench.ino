@@ -0,0 +1,63 @@
+// Compares the sorted map layout of MedianFilter (MedianFilterEngine::Sorted) with the
+// interleaved { value, slot } record layout (MedianFilterEngine::Interleaved) for windows
+// from 3 to 4095 samples on random input.
+// Prints the average processing time per sample in microseconds.
+// Windows that do not fit the board's RAM are skipped, trim WINDOWS on small boards.
+// On a host, the layout cases of bench/median_filter_bench.cpp time the same comparison.
+
+#include <MedianFilter.h>
+
+const int SAMPLES = 2000;
+const size_t WINDOWS[] = { 3, 7, 15, 31, 63, 127, 255, 511, 1023, 2047, 4095 };
+
+int randomInput[SAMPLES];
+
+float timeEngine(size_t window, MedianFilterEngine engine)
+{
+  MedianFilter<int, long, uint16_t> filter(window, 0, engine);
+
+  long check = 0;
+  unsigned long start = micros();
+  for(int i = 0; i < SAMPLES; i++)
+  {
+    check += filter.in(randomInput[i]);
+  }
+  unsigned long elapsed = micros() - start;
+
+  if(check == 12345) Serial.print(" ");   // keep the results alive
+  return (float) elapsed / SAMPLES;
+}
+
+bool fits(size_t window)
+{
+  // the larger of the two layouts, allocated and released once before timing
+  void * probe = malloc(window * (sizeof(int) + 2 * sizeof(uint16_t) + sizeof(int) + sizeof(uint16_t)) + MEDIAN_FILTER_CACHE_LINE + 256);
+  free(probe);
+  return probe != nullptr;
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("*** Storage layout benchmark ***");
+  delay(500);
+
+  for(int i = 0; i < SAMPLES; i++)
+  {
+    randomInput[i] = int(random(-1000, 1000));
+  }
+
+  Serial.println("Window\tsorted map [us]\tinterleaved [us]");
+  for(size_t window : WINDOWS)
+  {
+    if(!fits(window)) break;
+
+    Serial.print(window);
+    Serial.print("\t");
+    Serial.print(timeEngine(window, MedianFilterEngine::Sorted));
+    Serial.print("\t");
+    Serial.println(timeEngine(window, MedianFilterEngine::Interleaved));
+  }
+}
+
+void loop() {
+}
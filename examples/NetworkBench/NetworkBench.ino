@@ -0,0 +1,65 @@
+// Compares the selection network kernels of StaticMedianFilter (N = 3, 5, 7, 9)
+// with the insertion path of MedianFilter (MedianFilterEngine::Sorted, Auto would
+// pick the same networks) on random and on monotone input.
+// Prints the average processing time per sample in microseconds.
+
+#include <MedianFilter.h>
+#include <StaticMedianFilter.h>
+
+const int SAMPLES = 2000;
+
+int randomInput[SAMPLES];
+int rampInput[SAMPLES];
+
+template <typename Filter>
+float timeFilter(Filter & filter, const int * input)
+{
+  long check = 0;
+  unsigned long start = micros();
+  for(int i = 0; i < SAMPLES; i++)
+  {
+    check += filter.in(input[i]);
+  }
+  unsigned long elapsed = micros() - start;
+
+  if(check == 12345) Serial.print(" ");   // keep the results alive
+  return (float) elapsed / SAMPLES;
+}
+
+template <size_t N>
+void compare()
+{
+  StaticMedianFilter<int, long, N> network(0);
+  MedianFilter<int, long> insertion(N, 0, MedianFilterEngine::Sorted);
+
+  Serial.print(N);
+  Serial.print("\t");
+  Serial.print(timeFilter(network, randomInput));
+  Serial.print("\t");
+  Serial.print(timeFilter(insertion, randomInput));
+  Serial.print("\t");
+  Serial.print(timeFilter(network, rampInput));
+  Serial.print("\t");
+  Serial.println(timeFilter(insertion, rampInput));
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("*** Sorting network benchmark ***");
+  delay(500);
+
+  for(int i = 0; i < SAMPLES; i++)
+  {
+    randomInput[i] = int(random(-1000, 1000));
+    rampInput[i] = i;
+  }
+
+  Serial.println("Window\tnetwork random [us]\tinsertion random [us]\tnetwork ramp [us]\tinsertion ramp [us]");
+  compare<3>();
+  compare<5>();
+  compare<7>();
+  compare<9>();
+}
+
+void loop() {
+}
@@ -0,0 +1,447 @@
+/*
+  median_filter_test.cpp - Regression checks for the MedianFilter library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   Each check prints the failing expression and the test exits non zero when any check failed.
+ */
+
+#include <MedianFilter.h>
+#include <HoppingMedianFilter.h>
+#include <LazyMedianFilter.h>
+#include <MedianFilterBank.h>
+#include <MedianFilterParallel.h>
+#include <MedianFilterSharded.h>
+#include <MedianFilterSimd.h>
+#include <StaticMedianFilter.h>
+#include <TimedMedianFilter.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+   int failures = 0;
+
+   #define CHECK_EQUAL(actual, expected)                                                                  \
+      do                                                                                                  \
+      {                                                                                                   \
+         const auto a = (actual);                                                                         \
+         const auto e = (expected);                                                                       \
+         if(!(a == e))                                                                                    \
+         {                                                                                                \
+            printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, (long long) a, (long long) e); \
+            failures++;                                                                                   \
+         }                                                                                                \
+      } while(0)
+
+   #define CHECK(condition)                                                                               \
+      do                                                                                                  \
+      {                                                                                                   \
+         if(!(condition))                                                                                 \
+         {                                                                                                \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition);                                  \
+            failures++;                                                                                   \
+         }                                                                                                \
+      } while(0)
+
+   // same value, bit for bit, so NaN matches NaN and -0 does not match +0
+   template <typename T>
+   bool same(const T & a, const T & b)
+   {
+      return memcmp(&a, &b, sizeof(T)) == 0;
+   }
+
+   // reproducible noise in [-range, range], with a few long runs of one value so ties get exercised
+   template <typename T>
+   std::vector<T> noise(size_t n, int range, unsigned seed)
+   {
+      std::mt19937 random(seed);
+      std::uniform_int_distribution<int> value(-range, range);
+      std::vector<T> samples(n);
+      for(size_t i = 0; i < n; i++)
+      {
+         samples[i] = (i % 97 < 10 && i > 0) ? samples[i - 1] : (T) value(random);
+      }
+      return samples;
+   }
+
+   // every query of a filter matches the same query of a reference filter fed the same samples
+   template <typename Filter, typename Reference>
+   bool same_queries(const Filter & filter, const Reference & reference, size_t window)
+   {
+      bool equal = same(filter.out(), reference.out()) && same(filter.getMin(), reference.getMin()) &&
+                   same(filter.getMax(), reference.getMax()) && same(filter.getMAD(), reference.getMAD()) &&
+                   same(filter.getStdDev(), reference.getStdDev()) && same(filter.getMean(), reference.getMean());
+      for(size_t k = 0; k < window; k++) equal = equal && same(filter.getRank(k), reference.getRank(k));
+      return equal;
+   }
+
+   // the mean of a window holding negative samples stays negative, Sum is not divided as an unsigned window size
+   void negative_mean()
+   {
+      MedianFilter<int, long> dynamic(5, 0);
+      dynamic.in(-10);
+      CHECK_EQUAL(dynamic.getMean(), -2L);
+
+      MedianFilter<int, int, uint32_t> wide(5, 0);
+      wide.in(-10);
+      CHECK_EQUAL(wide.getMean(), -2);
+
+      StaticMedianFilter<int, long, 5> fixed(0);
+      fixed.in(-10);
+      CHECK_EQUAL(fixed.getMean(), -2L);
+
+      for(int i = 0; i < 5; i++) fixed.in(-7);
+      CHECK_EQUAL(fixed.getMean(), -7L);
+
+      MedianFilterBank<int, int, 2, uint32_t> bank(5, 0);
+      const int samples[2] = { -10, 10 };
+      int medians[2];
+      bank.in(samples, medians);
+      CHECK_EQUAL(bank.getMean(0), -2);
+      CHECK_EQUAL(bank.getMean(1), 2);
+
+      TimedMedianFilter<int, int, uint32_t, uint32_t> timed(100, 8);
+      timed.in(-10, 0);
+      timed.in(-20, 1);
+      CHECK_EQUAL(timed.getMean(), -15);
+
+      LazyMedianFilter<int, int, uint32_t> lazy(5, 0);
+      lazy.in(-10);
+      CHECK_EQUAL(lazy.getMean(), -2);
+   }
+
+   // an empty buffer leaves the lazy filter untouched and never reaches memcpy
+   void lazy_empty_buffer()
+   {
+      LazyMedianFilter<int, long> lazy(5, 3);
+      lazy.in(nullptr, 0);
+      CHECK_EQUAL(lazy.out(), 3);
+
+      const int samples[3] = { 9, 1, 5 };
+      lazy.in(samples, 3);
+      lazy.in(samples, 0);
+      CHECK_EQUAL(lazy.out(), 3);
+      CHECK_EQUAL(lazy.getMax(), 9);
+   }
+
+   // the batch in() writes what in() returns for every sample, for buffers of any length, in place or not
+   template <typename T, typename Sum>
+   void batch_matches_single(bool withNaN)
+   {
+      std::vector<T> samples = noise<T>(3000, 300, 3);
+      if(withNaN) for(size_t i = 17; i < samples.size(); i += 101) samples[i] = (T) NAN;
+
+      const MedianFilterEngine engines[] = { MedianFilterEngine::Auto, MedianFilterEngine::Sorted, MedianFilterEngine::Tree,
+                                             MedianFilterEngine::Histogram, MedianFilterEngine::Interleaved, MedianFilterEngine::Network };
+      for(MedianFilterEngine engine : engines)
+      {
+         for(size_t window : { 3, 5, 8, 31, 300 })
+         {
+            MedianFilter<T, Sum, uint16_t> single(window, 0, engine);
+            MedianFilter<T, Sum, uint16_t> batch(window, 0, engine);
+            std::vector<T> expected(samples.size()), filtered(samples);
+            for(size_t i = 0; i < samples.size(); i++) expected[i] = single.in(samples[i]);
+
+            // blocks of 0 to 96 samples, every other one filtered in place
+            size_t done = 0;
+            for(size_t block = 0; done < samples.size(); block++)
+            {
+               const size_t n = std::min((block * 37) % 97, samples.size() - done);
+               std::vector<T> out(n);
+               batch.in(&filtered[done], (block & 1) ? &filtered[done] : out.data(), n);
+               if(!(block & 1)) std::copy(out.begin(), out.end(), filtered.begin() + done);
+               done += n;
+            }
+
+            bool equal = true;
+            for(size_t i = 0; i < samples.size(); i++) equal = equal && same(filtered[i], expected[i]);
+            CHECK(equal);
+            CHECK(same_queries(batch, single, window));
+         }
+      }
+
+      StaticMedianFilter<T, Sum, 9> single(0), batch(0);
+      std::vector<T> expected(samples.size()), filtered(samples.size());
+      for(size_t i = 0; i < samples.size(); i++) expected[i] = single.in(samples[i]);
+      batch.in(samples.data(), filtered.data(), samples.size());
+      CHECK(memcmp(filtered.data(), expected.data(), samples.size() * sizeof(T)) == 0);
+   }
+
+   // median_filter_parallel() writes bit for bit what median_filter() writes, for any thread count and signal length
+   template <typename T>
+   void parallel_matches_offline(bool withNaN)
+   {
+      std::vector<T> samples = noise<T>(20011, 500, 9);
+      if(withNaN) for(size_t i = 5; i < samples.size(); i += 89) samples[i] = (T) NAN;
+
+      const MedianEdgeMode edges[] = { MedianEdgeMode::Zero, MedianEdgeMode::Nearest, MedianEdgeMode::Reflect };
+      for(MedianEdgeMode edge : edges)
+      {
+         for(size_t n : { 0, 1, 6, 300, 20011 })
+         {
+            for(size_t window : { 1, 2, 3, 8, 31, 255 })
+            {
+               std::vector<T> expected(n + 1), parallel(n + 1);
+               median_filter(samples.data(), expected.data(), n, window, edge);
+               for(unsigned threads : { 1, 2, 3, 8 })
+               {
+                  std::fill(parallel.begin(), parallel.end(), T(-1));
+                  median_filter_parallel(samples.data(), parallel.data(), n, window, edge, threads);
+                  CHECK(memcmp(parallel.data(), expected.data(), n * sizeof(T)) == 0);
+                  CHECK(same(parallel[n], T(-1)));   // nothing written past the signal
+               }
+            }
+         }
+      }
+   }
+
+   // the vector lanes give bit for bit the scalar network's median for every channel, including the leftover ones
+   template <typename T>
+   void simd_matches_scalar(bool withNaN)
+   {
+      std::vector<T> samples = noise<T>(9 * 80, 30000, 13);   // wraps around the narrow and unsigned types
+      if(withNaN)
+      {
+         for(size_t i = 3; i < samples.size(); i += 11) samples[i] = (T) NAN;
+         for(size_t i = 7; i < samples.size(); i += 23) samples[i] = (T) -0.0;
+      }
+
+      for(size_t window : { 3, 5, 7, 9 })
+      {
+         for(size_t channels = 1; channels <= 80; channels += (channels < 40) ? 1 : 13)
+         {
+            std::vector<T> medians(channels + 1, T(1));
+            median_filter_detail::network_medians(samples.data(), window, channels, medians.data());
+
+            bool equal = true;
+            for(size_t c = 0; c < channels; c++)
+            {
+               equal = equal && same(medians[c], median_filter_detail::network_median(samples.data() + c, window, channels));
+            }
+            CHECK(equal);
+            CHECK(same(medians[channels], T(1)));   // nothing written past the last channel
+         }
+      }
+   }
+
+   // an engine answers every query like the sorted map, sample by sample, and after a copy and a reset
+   template <typename T, typename Sum, typename Index>
+   void engine_matches_sorted(MedianFilterEngine engine, std::initializer_list<size_t> windows, const std::vector<T> & samples)
+   {
+      for(size_t window : windows)
+      {
+         MedianFilter<T, Sum, Index> filter(window, 3, engine);
+         MedianFilter<T, Sum, Index> sorted(window, 3, MedianFilterEngine::Sorted);
+         CHECK(filter.getEngine() == engine);
+
+         bool equal = true;
+         for(size_t i = 0; i < samples.size(); i++)
+         {
+            equal = equal && same(filter.in(samples[i]), sorted.in(samples[i]));
+            if(i % (window / 2 + 17) == 0) equal = equal && same_queries(filter, sorted, window);
+         }
+         CHECK(equal);
+
+         MedianFilter<T, Sum, Index> copy(filter);
+         CHECK(same_queries(copy, sorted, window));
+
+         filter.reset(-4);
+         sorted.reset(-4);
+         CHECK(same_queries(filter, sorted, window));
+      }
+   }
+
+   // the order statistic tree, from the smallest window to past the Auto threshold
+   void tree_engine()
+   {
+      engine_matches_sorted<int, long, uint16_t>(MedianFilterEngine::Tree, { 3, 4, 10, 64, 257, 1000 }, noise<int>(6000, 200, 21));
+      engine_matches_sorted<double, double, uint16_t>(MedianFilterEngine::Tree, { 3, 31, 300 }, noise<double>(3000, 200, 22));
+   }
+
+   // the counting histogram, over the whole range of each sample type and over a few values with many ties
+   void histogram_engine()
+   {
+      engine_matches_sorted<int8_t, long, uint16_t>(MedianFilterEngine::Histogram, { 3, 30, 500 }, noise<int8_t>(4000, 30000, 31));
+      engine_matches_sorted<uint8_t, long, uint16_t>(MedianFilterEngine::Histogram, { 3, 30, 500 }, noise<uint8_t>(4000, 30000, 32));
+      engine_matches_sorted<int16_t, long, uint16_t>(MedianFilterEngine::Histogram, { 4, 63, 1000 }, noise<int16_t>(4000, 30000, 33));
+      engine_matches_sorted<uint16_t, long, uint16_t>(MedianFilterEngine::Histogram, { 4, 63, 1000 }, noise<uint16_t>(4000, 30000, 34));
+      engine_matches_sorted<int16_t, long, uint16_t>(MedianFilterEngine::Histogram, { 5, 99 }, noise<int16_t>(4000, 3, 35));
+   }
+
+   // the interleaved { value, slot } records, NaN samples included
+   void interleaved_engine()
+   {
+      std::vector<double> withNaN = noise<double>(3000, 200, 43);
+      for(size_t i = 29; i < withNaN.size(); i += 131) withNaN[i] = NAN;
+
+      engine_matches_sorted<int, long, uint16_t>(MedianFilterEngine::Interleaved, { 3, 4, 10, 64, 255, 1000 }, noise<int>(6000, 200, 41));
+      engine_matches_sorted<int16_t, long, uint8_t>(MedianFilterEngine::Interleaved, { 3, 31, 255 }, noise<int16_t>(3000, 30000, 42));
+      engine_matches_sorted<double, double, uint16_t>(MedianFilterEngine::Interleaved, { 3, 31, 300 }, withNaN);
+   }
+
+   // the selection network engine answers like the sorted map for windows of 3, 5, 7 and 9
+   template <typename T, typename Sum>
+   void network_engine()
+   {
+      const std::vector<T> samples = noise<T>(3000, 40, 7);
+
+      for(size_t window : { 3, 5, 7, 9 })
+      {
+         MedianFilter<T, Sum> automatic(window, 0);
+         MedianFilter<T, Sum> network(window, 0, MedianFilterEngine::Network);
+         MedianFilter<T, Sum> sorted(window, 0, MedianFilterEngine::Sorted);
+         CHECK(automatic.getEngine() == MedianFilterEngine::Network);
+         CHECK(network.getEngine() == MedianFilterEngine::Network);
+
+         std::vector<T> batch(samples.size());
+         automatic.in(samples.data(), batch.data(), samples.size());
+
+         for(size_t i = 0; i < samples.size(); i++)
+         {
+            CHECK(same(network.in(samples[i]), sorted.in(samples[i])));
+            CHECK(same(batch[i], sorted.out()));
+            if(i % 13 == 0) CHECK(same_queries(network, sorted, window));
+         }
+
+         std::vector<T> fromNetwork(network.sorted().begin(), network.sorted().end());
+         std::vector<T> fromSorted(sorted.sorted().begin(), sorted.sorted().end());
+         CHECK(fromNetwork == fromSorted);
+
+         MedianFilter<T, Sum> copy(network);
+         CHECK(same_queries(copy, sorted, window));
+      }
+
+      MedianFilter<T, Sum> wide(11, 0, MedianFilterEngine::Network);
+      CHECK(wide.getEngine() == MedianFilterEngine::Sorted);   // no network for 11 samples
+   }
+
+   // every completed hop reports what MedianFilter returns for that sample, and the queries describe the same window
+   template <typename T, typename Sum>
+   void hopping_matches()
+   {
+      const std::vector<T> samples = noise<T>(2000, 50, 5);
+
+      for(size_t window : { 7, 31, 64 })
+      {
+         for(size_t hop : { (size_t) 1, (size_t) 5, window / 2, window, window + 3 })
+         {
+            HoppingMedianFilter<T, Sum> hopping(window, hop, 0);
+            MedianFilter<T, Sum> reference(window, 0);
+            std::vector<T> batch(samples.size());
+            HoppingMedianFilter<T, Sum> batched(window, hop, 0);
+            const size_t reported = batched.in(samples.data(), batch.data(), samples.size());
+
+            size_t hops = 0;
+            for(size_t i = 0; i < samples.size(); i++)
+            {
+               const T median = reference.in(samples[i]);
+               if(!hopping.in(samples[i])) continue;
+
+               CHECK(same(hopping.out(), median));
+               CHECK(hops < reported && same(batch[hops], median));
+               CHECK(same(hopping.getMin(), reference.getMin()));
+               CHECK(same(hopping.getMax(), reference.getMax()));
+               CHECK(same(hopping.getMean(), reference.getMean()));
+               for(size_t k = 0; k < window; k += 3) CHECK(same(hopping.getRank(k), reference.getRank(k)));
+               CHECK(same(hopping.getQuantile(0.9), reference.getQuantile(0.9)));
+               hops++;
+            }
+            CHECK_EQUAL(hops, reported);
+            CHECK_EQUAL(hops, (samples.size() / hop));
+         }
+      }
+   }
+
+   // samples ingested before a query are in its answer, exact with one point per window sample
+   void sharded_ingest_then_query()
+   {
+      const size_t shards = 3, window = 31;   // an odd pooled count, one middle rank
+      const std::vector<int> samples = noise<int>(shards * (3 * window + 5), 1000, 11);
+
+      for(size_t taken : { 3 * window, 3 * window + 5 })
+      {
+         ShardedMedianFilter<int, long, uint32_t> sharded(shards, window, -5000, window);
+         std::vector<int> pooled;
+         for(size_t s = 0; s < shards; s++)
+         {
+            const int * begin = &samples[s * taken];
+            for(size_t i = 0; i < taken; i++) sharded.shard(s).in(begin[i]);
+            pooled.insert(pooled.end(), begin + 3 * window - window, begin + 3 * window);   // the windows published at 3 * window
+         }
+         std::sort(pooled.begin(), pooled.end());
+
+         CHECK_EQUAL(sharded.out(), pooled[pooled.size() / 2]);
+         CHECK_EQUAL(sharded.getMin(), pooled.front());
+         CHECK_EQUAL(sharded.getMax(), pooled.back());
+         for(size_t s = 0; s < shards; s++) CHECK_EQUAL(sharded.shard(s).count(), (uint64_t) (3 * window));
+      }
+
+      // workers still feeding samples answer a query with their current windows
+      ShardedMedianFilter<int, long, uint32_t> busy(shards, window, -5000, window, 1000000);
+      std::atomic<bool> stop { false };
+      std::vector<std::thread> workers;
+      for(size_t s = 0; s < shards; s++)
+      {
+         workers.emplace_back([&busy, &stop, s] { while(!stop.load()) busy.shard(s).in(7); });
+      }
+      for(size_t s = 0; s < shards; s++) while(busy.shard(s).count() < window) busy.out();
+      CHECK_EQUAL(busy.out(), 7);
+      CHECK_EQUAL(busy.getMin(), 7);
+      stop.store(true);
+      for(std::thread & worker : workers) worker.join();
+   }
+}
+
+int main()
+{
+   negative_mean();
+   lazy_empty_buffer();
+   batch_matches_single<int16_t, long>(false);
+   batch_matches_single<int, long>(false);
+   batch_matches_single<float, double>(true);
+   batch_matches_single<double, double>(true);
+   parallel_matches_offline<int>(false);
+   parallel_matches_offline<float>(true);
+   simd_matches_scalar<int8_t>(false);
+   simd_matches_scalar<uint8_t>(false);
+   simd_matches_scalar<int16_t>(false);
+   simd_matches_scalar<uint16_t>(false);
+   simd_matches_scalar<int32_t>(false);
+   simd_matches_scalar<uint32_t>(false);
+   simd_matches_scalar<float>(true);
+   simd_matches_scalar<double>(true);
+   network_engine<int, long>();
+   network_engine<double, double>();
+   tree_engine();
+   histogram_engine();
+   interleaved_engine();
+   sharded_ingest_then_query();
+   hopping_matches<int, long>();
+   hopping_matches<double, double>();
+
+   if(failures) printf("%d checks failed\n", failures);
+   return failures ? 1 : 0;
+}